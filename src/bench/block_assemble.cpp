@@ -0,0 +1,70 @@
+// Copyright (c) 2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "miner.h"
+#include "txmempool.h"
+#include "validation.h"
+
+#include <vector>
+
+// Fill the mempool with independent transactions at a spread of feerates,
+// one in fifty of them already over the free threshold, and time the
+// assembly of a block template from scratch on top of the genesis block.
+static void AssembleBlock(benchmark::State& state, size_t nTxs)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    const CChainParams& chainparams = Params();
+
+    CBlockIndex indexGenesis(chainparams.GenesisBlock());
+    const uint256 hashGenesis = chainparams.GenesisBlock().GetHash();
+    indexGenesis.phashBlock = &hashGenesis;
+    indexGenesis.nHeight = 0;
+
+    LOCK(cs_main);
+    chainActive.SetTip(&indexGenesis);
+
+    for (size_t i = 0; i < nTxs; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(ArithToUint256(arith_uint256(i + 1)), 0);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        tx.vout[0].nValue = 1 * COIN;
+
+        CAmount nFee = 1000 + (i % 100) * 100;
+        double dPriority = (i % 50 == 0) ? AllowFreeThreshold() * 2 : 0;
+        LockPoints lp;
+        CTransactionRef txRef = MakeTransactionRef(tx);
+        mempool.addUnchecked(txRef->GetHash(), CTxMemPoolEntry(
+                                                   txRef, nFee, 0, dPriority, 1,
+                                                   txRef->GetValueOut(), false, 4, lp));
+    }
+
+    CScript scriptPubKey = CScript() << OP_TRUE;
+    while (state.KeepRunning()) {
+        blockTemplateCache.Clear();
+        BlockAssembler(chainparams).CreateNewBlock(nullptr, chainparams, scriptPubKey, false);
+    }
+
+    mempool.clear();
+    chainActive.SetTip(nullptr);
+}
+
+static void AssembleBlock10k(benchmark::State& state)
+{
+    AssembleBlock(state, 10000);
+}
+
+static void AssembleBlock50k(benchmark::State& state)
+{
+    AssembleBlock(state, 50000);
+}
+
+BENCHMARK(AssembleBlock10k);
+BENCHMARK(AssembleBlock50k);
@@ -6,6 +6,7 @@
 #define BITCOIN_BLOCK_ENCODINGS_H
 
 #include "primitives/block.h"
+#include "version.h"
 
 #include <memory>
 
@@ -144,6 +145,8 @@ protected:
 
 public:
     CBlockHeader header;
+    // PoS block signature, only sent to peers with CMPCTBLOCK_BLOCKSIG_VERSION
+    std::vector<unsigned char> vchBlockSig;
 
     // Dummy for deserialization
     CBlockHeaderAndShortTxIDs() {}
@@ -186,6 +189,9 @@ public:
 
         READWRITE(prefilledtxn);
 
+        if (s.GetVersion() >= CMPCTBLOCK_BLOCKSIG_VERSION)
+            READWRITE(vchBlockSig);
+
         if (ser_action.ForRead())
             FillShortTxIDSelector();
     }
@@ -198,6 +204,7 @@ protected:
     CTxMemPool* pool;
 public:
     CBlockHeader header;
+    std::vector<unsigned char> vchBlockSig;
     PartiallyDownloadedBlock(CTxMemPool* poolIn) : pool(poolIn) {}
 
     // extra_txn is a list of extra transactions to look at, in <hash, reference> form
@@ -0,0 +1,294 @@
+// Copyright (c) 2018 The Polis Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef EXPIRINGMAP_H_
+#define EXPIRINGMAP_H_
+
+#include <map>
+#include <vector>
+#include <cstddef>
+
+#include "serialize.h"
+
+/**
+ * Serializable structure for key/value items with an expiration time
+ */
+template<typename K, typename V>
+struct ExpiringItem
+{
+    ExpiringItem()
+        : nTimeExpire(0)
+    {}
+
+    ExpiringItem(const K& keyIn, const V& valueIn, int64_t nTimeExpireIn)
+        : key(keyIn),
+          value(valueIn),
+          nTimeExpire(nTimeExpireIn)
+    {}
+
+    K key;
+    V value;
+    int64_t nTimeExpire;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(key);
+        READWRITE(value);
+        READWRITE(nTimeExpire);
+    }
+};
+
+
+/**
+ * Map like container whose items expire at a given time. Items are also
+ * indexed by expiration time, so removing the expired ones only touches those.
+ * Once nMaxSize items are stored new keys are refused until RemoveExpired or
+ * Erase make room, so a flood of new keys can't push out the items still in
+ * use. A nMaxSize of 0 means no limit.
+ */
+template<typename K, typename V, typename Size = uint32_t>
+class ExpiringMap
+{
+public:
+    typedef Size size_type;
+
+    typedef ExpiringItem<K,V> item_t;
+
+    typedef std::multimap<int64_t, K> expiry_t;
+
+    typedef typename expiry_t::iterator expiry_it;
+
+    struct entry_t
+    {
+        V value;
+        expiry_it itExpiry;
+    };
+
+    typedef std::map<K, entry_t> map_t;
+
+    typedef typename map_t::iterator map_it;
+
+    typedef typename map_t::const_iterator map_cit;
+
+private:
+    size_type nMaxSize;
+
+    map_t mapItems;
+
+    expiry_t mapExpiry;
+
+public:
+    ExpiringMap(size_type nMaxSizeIn = 0)
+        : nMaxSize(nMaxSizeIn),
+          mapItems(),
+          mapExpiry()
+    {}
+
+    ExpiringMap(const ExpiringMap<K,V,Size>& other)
+        : nMaxSize(other.nMaxSize),
+          mapItems(),
+          mapExpiry()
+    {
+        CopyItems(other);
+    }
+
+    void Clear()
+    {
+        mapItems.clear();
+        mapExpiry.clear();
+    }
+
+    /**
+     * Shrinking the limit below the number of stored items drops the ones
+     * closest to expiring
+     */
+    void SetMaxSize(size_type nMaxSizeIn)
+    {
+        nMaxSize = nMaxSizeIn;
+        while(nMaxSize > 0 && mapItems.size() > nMaxSize) {
+            PruneFirst();
+        }
+    }
+
+    size_type GetMaxSize() const {
+        return nMaxSize;
+    }
+
+    size_type GetSize() const {
+        return mapItems.size();
+    }
+
+    bool IsFull() const
+    {
+        return nMaxSize > 0 && mapItems.size() >= nMaxSize;
+    }
+
+    /**
+     * Add the item if the key is not known yet and there is room for it,
+     * return false otherwise
+     */
+    bool Insert(const K& key, const V& value, int64_t nTimeExpire)
+    {
+        if(mapItems.find(key) != mapItems.end()) {
+            return false;
+        }
+        return Set(key, value, nTimeExpire);
+    }
+
+    /**
+     * Replace the value and expiration time of a known key, or add the item
+     * if there is room for it. Return false if the item was not stored
+     */
+    bool Set(const K& key, const V& value, int64_t nTimeExpire)
+    {
+        map_it it = mapItems.find(key);
+        if(it != mapItems.end()) {
+            mapExpiry.erase(it->second.itExpiry);
+            it->second.value = value;
+            it->second.itExpiry = mapExpiry.emplace(nTimeExpire, key);
+            return true;
+        }
+        if(IsFull()) {
+            return false;
+        }
+        entry_t entry;
+        entry.value = value;
+        entry.itExpiry = mapExpiry.emplace(nTimeExpire, key);
+        mapItems.emplace(key, entry);
+        return true;
+    }
+
+    bool HasKey(const K& key) const
+    {
+        return (mapItems.find(key) != mapItems.end());
+    }
+
+    bool Get(const K& key, V& value) const
+    {
+        map_cit it = mapItems.find(key);
+        if(it == mapItems.end()) {
+            return false;
+        }
+        value = it->second.value;
+        return true;
+    }
+
+    /**
+     * Expiration time of the item, 0 if the key is not known
+     */
+    int64_t GetExpireTime(const K& key) const
+    {
+        map_cit it = mapItems.find(key);
+        if(it == mapItems.end()) {
+            return 0;
+        }
+        return it->second.itExpiry->first;
+    }
+
+    void Erase(const K& key)
+    {
+        map_it it = mapItems.find(key);
+        if(it == mapItems.end()) {
+            return;
+        }
+        mapExpiry.erase(it->second.itExpiry);
+        mapItems.erase(it);
+    }
+
+    /**
+     * Remove the items from the first key not less than keyFirst on, for as
+     * long as fErase(key) holds, return how many were removed
+     */
+    template<typename Pred>
+    size_type EraseFrom(const K& keyFirst, Pred fErase)
+    {
+        size_type nRemoved = 0;
+        map_it it = mapItems.lower_bound(keyFirst);
+        while(it != mapItems.end() && fErase(it->first)) {
+            mapExpiry.erase(it->second.itExpiry);
+            mapItems.erase(it++);
+            ++nRemoved;
+        }
+        return nRemoved;
+    }
+
+    /**
+     * Remove the items which expired before nTime, return how many were removed
+     */
+    size_type RemoveExpired(int64_t nTime)
+    {
+        size_type nRemoved = 0;
+        while(!mapExpiry.empty() && mapExpiry.begin()->first < nTime) {
+            PruneFirst();
+            ++nRemoved;
+        }
+        return nRemoved;
+    }
+
+    std::vector<item_t> GetItemList() const
+    {
+        std::vector<item_t> vecItems;
+        vecItems.reserve(mapItems.size());
+        for(const auto& expiry : mapExpiry) {
+            vecItems.push_back(item_t(expiry.second, mapItems.find(expiry.second)->second.value, expiry.first));
+        }
+        return vecItems;
+    }
+
+    ExpiringMap<K,V,Size>& operator=(const ExpiringMap<K,V,Size>& other)
+    {
+        nMaxSize = other.nMaxSize;
+        Clear();
+        CopyItems(other);
+        return *this;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    /**
+     * Only the items are stored, the size limit is left as set by the owner.
+     * If it is lower than the number of stored items the ones expiring last
+     * are kept
+     */
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        std::vector<item_t> vecItems;
+        if(!ser_action.ForRead()) {
+            vecItems = GetItemList();
+        }
+        READWRITE(vecItems);
+        if(ser_action.ForRead()) {
+            Clear();
+            for(typename std::vector<item_t>::const_reverse_iterator it = vecItems.rbegin(); it != vecItems.rend(); ++it) {
+                Set(it->key, it->value, it->nTimeExpire);
+            }
+        }
+    }
+
+private:
+    void PruneFirst()
+    {
+        if(mapExpiry.empty()) {
+            return;
+        }
+        mapItems.erase(mapExpiry.begin()->second);
+        mapExpiry.erase(mapExpiry.begin());
+    }
+
+    void CopyItems(const ExpiringMap<K,V,Size>& other)
+    {
+        for(const auto& expiry : other.mapExpiry) {
+            entry_t entry;
+            entry.value = other.mapItems.find(expiry.second)->second.value;
+            entry.itExpiry = mapExpiry.emplace(expiry.first, expiry.second);
+            mapItems.emplace(expiry.second, entry);
+        }
+    }
+};
+
+#endif /* EXPIRINGMAP_H_ */
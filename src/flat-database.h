@@ -37,6 +37,26 @@ private:
     std::string strFilename;
     std::string strMagicMessage;
 
+    /** Whether the file already holds exactly nSize bytes ending in hash */
+    bool IsUnchanged(uint64_t nSize, const uint256& hash)
+    {
+        boost::system::error_code ec;
+        if (boost::filesystem::file_size(pathDB, ec) != nSize || ec)
+            return false;
+
+        CAutoFile filein(fopen(pathDB.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull() || fseek(filein.Get(), -(long)sizeof(uint256), SEEK_END) != 0)
+            return false;
+        uint256 hashIn;
+        try {
+            filein >> hashIn;
+        }
+        catch (std::exception &e) {
+            return false;
+        }
+        return hashIn == hash;
+    }
+
     bool Write(const T& objToSave)
     {
         // LOCK(objToSave.cs);
@@ -51,11 +71,19 @@ private:
         uint256 hash = Hash(ssObj.begin(), ssObj.end());
         ssObj << hash;
 
-        // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        if (IsUnchanged(ssObj.size(), hash)) {
+            LogPrintf("%s is unchanged  %dms\n", strFilename, GetTimeMillis() - nStart);
+            return true;
+        }
+
+        // Write a new file and only then replace the old one, so that the
+        // cache is not lost if we are interrupted while writing
+        boost::filesystem::path pathTmp = pathDB;
+        pathTmp += ".new";
+        FILE *file = fopen(pathTmp.string().c_str(), "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
         // Write and commit header, data
         try {
@@ -64,8 +92,12 @@ private:
         catch (std::exception &e) {
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        FileCommit(fileout.Get());
         fileout.fclose();
 
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Rename-into-place failed for %s", __func__, pathDB.string());
+
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
 
@@ -92,13 +124,15 @@ private:
         // Don't try to resize to a negative number if file is small
         if (dataSize < 0)
             dataSize = 0;
-        std::vector<unsigned char> vchData;
-        vchData.resize(dataSize);
+        // read data straight into the stream it is deserialized from
+        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+        ssObj.resize(dataSize);
         uint256 hashIn;
 
         // read data and checksum from file
         try {
-            filein.read((char *)&vchData[0], dataSize);
+            if (dataSize > 0)
+                filein.read((char *)&ssObj[0], dataSize);
             filein >> hashIn;
         }
         catch (std::exception &e) {
@@ -107,8 +141,6 @@ private:
         }
         filein.fclose();
 
-        CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
-
         // verify stored checksum matches input data
         uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
         if (hashIn != hashTmp)
@@ -162,6 +194,37 @@ private:
         return Ok;
     }
 
+    /** Check only that the file belongs to this kind of object and network */
+    ReadResult ReadHeader()
+    {
+        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return FileError;
+
+        std::string strMagicMessageTmp;
+        unsigned char pchMsgTmp[4];
+        try {
+            filein >> LIMITED_STRING(strMagicMessageTmp, 64);
+            if (strMagicMessage != strMagicMessageTmp)
+            {
+                error("%s: Invalid magic message", __func__);
+                return IncorrectMagicMessage;
+            }
+
+            filein >> FLATDATA(pchMsgTmp);
+            if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+            {
+                error("%s: Invalid network magic number", __func__);
+                return IncorrectMagicNumber;
+            }
+        }
+        catch (std::exception &e) {
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return IncorrectFormat;
+        }
+        return Ok;
+    }
 
 public:
     CFlatDB(std::string strFilenameIn, std::string strMagicMessageIn)
@@ -171,10 +234,15 @@ public:
         strMagicMessage = strMagicMessageIn;
     }
 
-    bool Load(T& objToLoad)
+    /**
+     * Load objToLoad from the file. Unless fCheckAndRemove is false, expired
+     * entries are cleaned up right away; otherwise the caller has to call
+     * CheckAndRemove itself, e.g. once several caches are loaded in parallel.
+     */
+    bool Load(T& objToLoad, bool fCheckAndRemove = true)
     {
         LogPrintf("Reading info from %s...\n", strFilename);
-        ReadResult readResult = Read(objToLoad);
+        ReadResult readResult = Read(objToLoad, !fCheckAndRemove);
         if (readResult == FileError)
             LogPrintf("Missing file %s, will try to recreate\n", strFilename);
         else if (readResult != Ok)
@@ -197,9 +265,10 @@ public:
     {
         int64_t nStart = GetTimeMillis();
 
+        // Only the header is checked here; deserializing the old file in full
+        // to verify it would take as long as writing the new one
         LogPrintf("Verifying %s format...\n", strFilename);
-        T tmpObjToLoad;
-        ReadResult readResult = Read(tmpObjToLoad, true);
+        ReadResult readResult = ReadHeader();
 
         // there was an error and it was not an error on file opening => do not proceed
         if (readResult == FileError)
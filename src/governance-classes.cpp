@@ -138,6 +138,7 @@ bool CGovernanceTriggerManager::AddNewTrigger(uint256 nHash)
 
     DBG( std::cout << "CGovernanceTriggerManager::AddNewTrigger: Inserting trigger" << std::endl; );
     mapTrigger.insert(std::make_pair(nHash, pSuperblock));
+    mapTriggersByHeight.clear();
 
     DBG( std::cout << "CGovernanceTriggerManager::AddNewTrigger: End" << std::endl; );
 
@@ -215,6 +216,7 @@ void CGovernanceTriggerManager::CleanAndRemove()
             }
             // delete the trigger
             mapTrigger.erase(it++);
+            mapTriggersByHeight.clear();
         }
         else  {
             ++it;
@@ -227,31 +229,35 @@ void CGovernanceTriggerManager::CleanAndRemove()
 /**
 *   Get Active Triggers
 *
-*   - Look through triggers and scan for active ones
+*   - Look through the triggers of superblocks at nBlockHeight and scan for active ones
 *   - Return the triggers in a list
 */
 
-std::vector<CSuperblock_sptr> CGovernanceTriggerManager::GetActiveTriggers()
+std::vector<CSuperblock_sptr> CGovernanceTriggerManager::GetActiveTriggers(int nBlockHeight)
 {
     AssertLockHeld(governance.cs);
-    std::vector<CSuperblock_sptr> vecResults;
-
-    DBG( std::cout << "GetActiveTriggers: mapTrigger.size() = " << mapTrigger.size() << std::endl; );
-
-    // LOOK AT THESE OBJECTS AND COMPILE A VALID LIST OF TRIGGERS
-    trigger_m_it it = mapTrigger.begin();
-    while(it != mapTrigger.end()) {
-
-        CGovernanceObject* pObj = governance.FindGovernanceObject((*it).first);
 
-        if(pObj) {
-            DBG( std::cout << "GetActiveTriggers: pObj->GetDataAsPlainString() = " << pObj->GetDataAsPlainString() << std::endl; );
-            vecResults.push_back(it->second);
+    trigger_height_m_it itHeight = mapTriggersByHeight.find(nBlockHeight);
+    if(itHeight == mapTriggersByHeight.end()) {
+        if(mapTriggersByHeight.size() >= MAX_CACHED_HEIGHTS) {
+            mapTriggersByHeight.clear();
         }
-        ++it;
+        std::vector<CSuperblock_sptr> vecTriggers;
+        for(trigger_m_cit it = mapTrigger.begin(); it != mapTrigger.end(); ++it) {
+            if(it->second && it->second->GetBlockHeight() == nBlockHeight) {
+                vecTriggers.push_back(it->second);
+            }
+        }
+        itHeight = mapTriggersByHeight.emplace(nBlockHeight, vecTriggers).first;
     }
 
-    DBG( std::cout << "GetActiveTriggers: vecResults.size() = " << vecResults.size() << std::endl; );
+    // objects can be gone before CleanAndRemove drops their triggers
+    std::vector<CSuperblock_sptr> vecResults;
+    for (const auto& pSuperblock : itHeight->second) {
+        if(governance.FindGovernanceObject(pSuperblock->GetGovernanceObjectHash())) {
+            vecResults.push_back(pSuperblock);
+        }
+    }
 
     return vecResults;
 }
@@ -270,8 +276,8 @@ bool CSuperblockManager::IsSuperblockTriggered(int nBlockHeight)
     }
 
     LOCK(governance.cs);
-    // GET ALL ACTIVE TRIGGERS
-    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers();
+    // GET ALL ACTIVE TRIGGERS FOR THIS HEIGHT
+    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers(nBlockHeight);
 
     LogPrint("gobject", "CSuperblockManager::IsSuperblockTriggered -- vecTriggers.size() = %d\n", vecTriggers.size());
 
@@ -334,7 +340,7 @@ bool CSuperblockManager::GetBestSuperblock(CSuperblock_sptr& pSuperblockRet, int
     }
 
     AssertLockHeld(governance.cs);
-    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers();
+    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers(nBlockHeight);
     int nYesCount = 0;
 
     for (const auto& pSuperblock : vecTriggers) {
@@ -44,14 +44,24 @@ private:
     typedef trigger_m_t::iterator trigger_m_it;
     typedef trigger_m_t::const_iterator trigger_m_cit;
 
+    typedef std::map<int, std::vector<CSuperblock_sptr> > trigger_height_m_t;
+    typedef trigger_height_m_t::iterator trigger_height_m_it;
+
+    // Don't cache the triggers of more heights than this
+    static const size_t MAX_CACHED_HEIGHTS = 16;
+
     trigger_m_t mapTrigger;
 
-    std::vector<CSuperblock_sptr> GetActiveTriggers();
+    // Triggers of mapTrigger by their superblock height, filled on demand
+    // and dropped whenever a trigger is added or removed
+    trigger_height_m_t mapTriggersByHeight;
+
+    std::vector<CSuperblock_sptr> GetActiveTriggers(int nBlockHeight);
     bool AddNewTrigger(uint256 nHash);
     void CleanAndRemove();
 
 public:
-    CGovernanceTriggerManager() : mapTrigger() {}
+    CGovernanceTriggerManager() : mapTrigger(), mapTriggersByHeight() {}
 };
 
 /**
@@ -181,6 +191,11 @@ public:
         return nBlockHeight;
     }
 
+    const uint256& GetGovernanceObjectHash() const
+    {
+        return nGovObjHash;
+    }
+
     int CountPayments() { return (int)vecPayments.size(); }
     bool GetPayment(int nPaymentIndex, CGovernancePayment& paymentRet);
     CAmount GetPaymentsTotalAmount();
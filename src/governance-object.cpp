@@ -37,6 +37,7 @@ CGovernanceObject::CGovernanceObject():
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    tallyCurrentMNVotes(),
     cmmapOrphanVotes(),
     fileVotes()
 {
@@ -65,6 +66,7 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    tallyCurrentMNVotes(),
     cmmapOrphanVotes(),
     fileVotes()
 {
@@ -93,6 +95,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other):
     fExpired(other.fExpired),
     fUnparsable(other.fUnparsable),
     mapCurrentMNVotes(other.mapCurrentMNVotes),
+    tallyCurrentMNVotes(other.tallyCurrentMNVotes),
     cmmapOrphanVotes(other.cmmapOrphanVotes),
     fileVotes(other.fileVotes)
 {}
@@ -199,7 +202,7 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         return false;
     }
 
-    voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
+    SetCurrentMNVote(vote.GetMasternodeOutpoint(), eSignal, vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp()));
     fileVotes.AddVote(vote);
     fDirtyCache = true;
     return true;
@@ -212,8 +215,7 @@ void CGovernanceObject::ClearMasternodeVotes()
     vote_m_it it = mapCurrentMNVotes.begin();
     while(it != mapCurrentMNVotes.end()) {
         if(!mnodeman.Has(it->first)) {
-            fileVotes.RemoveVotesFromMasternode(it->first);
-            mapCurrentMNVotes.erase(it++);
+            it = EraseCurrentMNVotes(it);
         }
         else {
             ++it;
@@ -221,6 +223,58 @@ void CGovernanceObject::ClearMasternodeVotes()
     }
 }
 
+void CGovernanceObject::SetCurrentMNVote(const COutPoint& outpoint, int nSignal, const vote_instance_t& voteInstance)
+{
+    AssertLockHeld(cs);
+
+    vote_instance_t& voteInstanceRef = mapCurrentMNVotes[outpoint].mapInstances[nSignal];
+    UpdateVoteTally(nSignal, voteInstanceRef.eOutcome, -1);
+    voteInstanceRef = voteInstance;
+    UpdateVoteTally(nSignal, voteInstanceRef.eOutcome, 1);
+}
+
+CGovernanceObject::vote_m_it CGovernanceObject::EraseCurrentMNVotes(vote_m_it it)
+{
+    AssertLockHeld(cs);
+
+    fileVotes.RemoveVotesFromMasternode(it->first);
+    UpdateVoteTally(it->second, -1);
+    return mapCurrentMNVotes.erase(it);
+}
+
+void CGovernanceObject::UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta)
+{
+    AssertLockHeld(cs);
+
+    // VOTE_OUTCOME_NONE is the placeholder of a signal not voted on yet
+    if(nSignal <= VOTE_SIGNAL_NONE || nSignal > MAX_SUPPORTED_VOTE_SIGNAL ||
+       eOutcome <= VOTE_OUTCOME_NONE || eOutcome > MAX_SUPPORTED_VOTE_OUTCOME) {
+        return;
+    }
+    tallyCurrentMNVotes[nSignal][eOutcome] += nDelta;
+}
+
+void CGovernanceObject::UpdateVoteTally(const vote_rec_t& voteRecord, int nDelta)
+{
+    AssertLockHeld(cs);
+
+    for (const auto& instancepair : voteRecord.mapInstances) {
+        UpdateVoteTally(instancepair.first, instancepair.second.eOutcome, nDelta);
+    }
+}
+
+void CGovernanceObject::RebuildVoteTally()
+{
+    LOCK(cs);
+
+    for (auto& tallySignal : tallyCurrentMNVotes) {
+        tallySignal.fill(0);
+    }
+    for (const auto& votepair : mapCurrentMNVotes) {
+        UpdateVoteTally(votepair.second, 1);
+    }
+}
+
 std::string CGovernanceObject::GetSignatureMessage() const
 {
     LOCK(cs);
@@ -636,15 +690,11 @@ int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote
 {
     LOCK(cs);
 
-    int nCount = 0;
-    for (const auto& votepair : mapCurrentMNVotes) {
-        const vote_rec_t& recVote = votepair.second;
-        vote_instance_m_cit it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if(it2 != recVote.mapInstances.end() && it2->second.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
-        }
+    if(eVoteSignalIn <= VOTE_SIGNAL_NONE || eVoteSignalIn > MAX_SUPPORTED_VOTE_SIGNAL ||
+       eVoteOutcomeIn <= VOTE_OUTCOME_NONE || eVoteOutcomeIn > MAX_SUPPORTED_VOTE_OUTCOME) {
+        return 0;
     }
-    return nCount;
+    return tallyCurrentMNVotes[eVoteSignalIn][eVoteOutcomeIn];
 }
 
 /**
@@ -19,11 +19,18 @@
 
 #include <univalue.h>
 
+#include <array>
+
 class CGovernanceManager;
 class CGovernanceTriggerManager;
 class CGovernanceObject;
 class CGovernanceVote;
 
+namespace governance_tests
+{
+    class TestGovernanceObject;
+}
+
 static const int MAX_GOVERNANCE_OBJECT_DATA_SIZE = 16 * 1024;
 static const int MIN_GOVERNANCE_PEER_PROTO_VERSION = 70208;
 static const int GOVERNANCE_FILTER_PROTO_VERSION = 70206;
@@ -112,6 +119,7 @@ class CGovernanceObject
     friend class CGovernanceManager;
     friend class CGovernanceTriggerManager;
     friend class CSuperblock;
+    friend class governance_tests::TestGovernanceObject; // for test access to the vote tally
 
 public: // Types
     typedef std::map<COutPoint, vote_rec_t> vote_m_t;
@@ -122,6 +130,8 @@ public: // Types
 
     typedef CacheMultiMap<COutPoint, vote_time_pair_t> vote_cmm_t;
 
+    typedef std::array<std::array<int, MAX_SUPPORTED_VOTE_OUTCOME + 1>, MAX_SUPPORTED_VOTE_SIGNAL + 1> vote_tally_t;
+
 private:
     /// critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -182,6 +192,9 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    /// Number of entries in mapCurrentMNVotes per signal and outcome, kept in step with it
+    vote_tally_t tallyCurrentMNVotes;
+
     /// Limited map of votes orphaned by MN
     vote_cmm_t cmmapOrphanVotes;
 
@@ -348,6 +361,9 @@ public:
             READWRITE(nDeletionTime);
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
+            if(ser_action.ForRead()) {
+                RebuildVoteTally();
+            }
             READWRITE(fileVotes);
             LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
         }
@@ -374,6 +390,21 @@ private:
     /// Called when MN's which have voted on this object have been removed
     void ClearMasternodeVotes();
 
+    /// Replace the vote instance of a masternode for a signal, keeping the tally in step
+    void SetCurrentMNVote(const COutPoint& outpoint, int nSignal, const vote_instance_t& voteInstance);
+
+    /// Drop every vote of the masternode at it, keeping the tally in step, return the next entry
+    vote_m_it EraseCurrentMNVotes(vote_m_it it);
+
+    /// Add nDelta to the tally of a single vote instance
+    void UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta);
+
+    /// Add nDelta to the tally of every vote instance of a masternode
+    void UpdateVoteTally(const vote_rec_t& voteRecord, int nDelta);
+
+    /// Recount the tally from mapCurrentMNVotes
+    void RebuildVoteTally();
+
     void CheckOrphanVotes(CConnman& connman);
 
 };
@@ -109,6 +109,18 @@ CGovernanceVote::CGovernanceVote(const COutPoint& outpointMasternodeIn, const ui
     UpdateHash();
 }
 
+CGovernanceVote::CGovernanceVote(const COutPoint& outpointMasternodeIn, const uint256& nParentHashIn, int nVoteSignalIn, int nVoteOutcomeIn, int64_t nTimeIn, const std::vector<unsigned char>& vchSigIn, const uint256& hashIn)
+    : fValid(true),
+      fSynced(false),
+      nVoteSignal(nVoteSignalIn),
+      masternodeOutpoint(outpointMasternodeIn),
+      nParentHash(nParentHashIn),
+      nVoteOutcome(nVoteOutcomeIn),
+      nTime(nTimeIn),
+      vchSig(vchSigIn),
+      hash(hashIn)
+{}
+
 std::string CGovernanceVote::ToString() const
 {
     std::ostringstream ostr;
@@ -32,6 +32,7 @@ enum vote_signal_enum_t  {
 };
 
 static const int MAX_SUPPORTED_VOTE_SIGNAL = VOTE_SIGNAL_ENDORSED;
+static const int MAX_SUPPORTED_VOTE_OUTCOME = VOTE_OUTCOME_ABSTAIN;
 
 /**
 * Governance Voting
@@ -75,6 +76,8 @@ private:
 public:
     CGovernanceVote();
     CGovernanceVote(const COutPoint& outpointMasternodeIn, const uint256& nParentHashIn, vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn);
+    /** Rebuild a stored vote, hashIn has to be the hash it had when stored */
+    CGovernanceVote(const COutPoint& outpointMasternodeIn, const uint256& nParentHashIn, int nVoteSignalIn, int nVoteOutcomeIn, int64_t nTimeIn, const std::vector<unsigned char>& vchSigIn, const uint256& hashIn);
 
     bool IsValid() const { return fValid; }
 
@@ -92,6 +95,8 @@ public:
 
     void SetSignature(const std::vector<unsigned char>& vchSigIn) { vchSig = vchSigIn; }
 
+    const std::vector<unsigned char>& GetSignature() const { return vchSig; }
+
     bool Sign(const CKey& keyMasternode, const CPubKey& pubKeyMasternode);
     bool CheckSignature(const CPubKey& pubKeyMasternode) const;
     bool IsValid(bool fSignatureCheck) const;
@@ -4,85 +4,210 @@
 
 #include "governance-votedb.h"
 
+#include <algorithm>
+
+const uint32_t CGovernanceObjectVoteFile::INDEX_EMPTY;
+
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile()
     : nMemoryVotes(0),
-      listVotes(),
-      mapVoteIndex()
+      vecVotes(),
+      vecOutpoints(),
+      mapOutpointIndex(),
+      vecParentHashes(),
+      vchSigArena(),
+      vecHashIndex()
 {}
 
-CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other)
-    : nMemoryVotes(other.nMemoryVotes),
-      listVotes(other.listVotes),
-      mapVoteIndex()
-{
-    RebuildIndex();
-}
-
 void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
 {
     uint256 nHash = vote.GetHash();
     // make sure to never add/update already known votes
     if (HasVote(nHash))
         return;
-    listVotes.push_front(vote);
-    mapVoteIndex.emplace(nHash, listVotes.begin());
+
+    CCompactVote compactVote;
+    compactVote.nHash = nHash;
+    compactVote.nTime = vote.GetTimestamp();
+    compactVote.nVoteSignal = int32_t(vote.GetSignal());
+    compactVote.nVoteOutcome = int32_t(vote.GetOutcome());
+
+    const COutPoint& outpoint = vote.GetMasternodeOutpoint();
+    std::map<COutPoint, uint32_t>::const_iterator itOutpoint = mapOutpointIndex.find(outpoint);
+    if(itOutpoint == mapOutpointIndex.end()) {
+        itOutpoint = mapOutpointIndex.emplace(outpoint, uint32_t(vecOutpoints.size())).first;
+        vecOutpoints.push_back(outpoint);
+    }
+    compactVote.nOutpointIndex = itOutpoint->second;
+
+    std::vector<uint256>::const_iterator itParent = std::find(vecParentHashes.begin(), vecParentHashes.end(), vote.GetParentHash());
+    if(itParent == vecParentHashes.end()) {
+        itParent = vecParentHashes.insert(vecParentHashes.end(), vote.GetParentHash());
+    }
+    compactVote.nParentIndex = uint32_t(itParent - vecParentHashes.begin());
+
+    const std::vector<unsigned char>& vchSig = vote.GetSignature();
+    compactVote.nSigOffset = uint32_t(vchSigArena.size());
+    compactVote.nSigSize = uint32_t(vchSig.size());
+    vchSigArena.insert(vchSigArena.end(), vchSig.begin(), vchSig.end());
+
+    vecVotes.push_back(compactVote);
     ++nMemoryVotes;
+
+    // keep the hash table at most half full
+    if(vecHashIndex.size() < 2 * vecVotes.size()) {
+        RebuildHashIndex();
+    } else {
+        InsertIntoHashIndex(uint32_t(vecVotes.size() - 1));
+    }
 }
 
 bool CGovernanceObjectVoteFile::HasVote(const uint256& nHash) const
 {
-    return mapVoteIndex.find(nHash) != mapVoteIndex.end();
+    return FindVote(nHash) != INDEX_EMPTY;
 }
 
 bool CGovernanceObjectVoteFile::SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const
 {
-    vote_m_cit it = mapVoteIndex.find(nHash);
-    if(it == mapVoteIndex.end()) {
+    uint32_t nPos = FindVote(nHash);
+    if(nPos == INDEX_EMPTY) {
         return false;
     }
-    ss << *(it->second);
+    ss << MakeVote(vecVotes[nPos]);
     return true;
 }
 
 std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
 {
     std::vector<CGovernanceVote> vecResult;
-    for(vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
-        vecResult.push_back(*it);
+    vecResult.reserve(vecVotes.size());
+    for(std::vector<CCompactVote>::const_reverse_iterator it = vecVotes.rbegin(); it != vecVotes.rend(); ++it) {
+        vecResult.push_back(MakeVote(*it));
+    }
+    return vecResult;
+}
+
+std::vector<uint256> CGovernanceObjectVoteFile::GetVoteHashes() const
+{
+    std::vector<uint256> vecResult;
+    vecResult.reserve(vecVotes.size());
+    for(std::vector<CCompactVote>::const_reverse_iterator it = vecVotes.rbegin(); it != vecVotes.rend(); ++it) {
+        vecResult.push_back(it->nHash);
     }
     return vecResult;
 }
 
+bool CGovernanceObjectVoteFile::GetVotesAfter(const uint256& nAfterHash, size_t nMax, std::vector<CGovernanceVote>& vecVotesRet) const
+{
+    vecVotesRet.clear();
+    // walk from the newest vote to the oldest, nPos is one past the next vote
+    size_t nPos = vecVotes.size();
+    if(!nAfterHash.IsNull()) {
+        uint32_t nAfterPos = FindVote(nAfterHash);
+        if(nAfterPos == INDEX_EMPTY) {
+            // the vote was removed, we can't tell where the walk was anymore
+            return false;
+        }
+        nPos = nAfterPos;
+    }
+    while(nPos > 0 && vecVotesRet.size() < nMax) {
+        vecVotesRet.push_back(MakeVote(vecVotes[--nPos]));
+    }
+    return true;
+}
+
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
-    vote_l_it it = listVotes.begin();
-    while(it != listVotes.end()) {
-        if(it->GetMasternodeOutpoint() == outpointMasternode) {
+    std::map<COutPoint, uint32_t>::iterator itOutpoint = mapOutpointIndex.find(outpointMasternode);
+    if(itOutpoint == mapOutpointIndex.end()) {
+        return;
+    }
+    uint32_t nOutpointIndex = itOutpoint->second;
+    // The last outpoint moves into the freed slot so that vecOutpoints stays dense
+    uint32_t nLastIndex = uint32_t(vecOutpoints.size() - 1);
+
+    // Drop the votes and their signatures
+    std::vector<CCompactVote> vecVotesKept;
+    std::vector<unsigned char> vchSigArenaKept;
+    vecVotesKept.reserve(vecVotes.size());
+    vchSigArenaKept.reserve(vchSigArena.size());
+    for(const auto& compactVote : vecVotes) {
+        if(compactVote.nOutpointIndex == nOutpointIndex) {
             --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
+            continue;
         }
-        else {
-            ++it;
+        vecVotesKept.push_back(compactVote);
+        if(compactVote.nOutpointIndex == nLastIndex) {
+            vecVotesKept.back().nOutpointIndex = nOutpointIndex;
         }
+        vecVotesKept.back().nSigOffset = uint32_t(vchSigArenaKept.size());
+        vchSigArenaKept.insert(vchSigArenaKept.end(),
+                               vchSigArena.begin() + compactVote.nSigOffset,
+                               vchSigArena.begin() + compactVote.nSigOffset + compactVote.nSigSize);
+    }
+    vecVotes.swap(vecVotesKept);
+    vchSigArena.swap(vchSigArenaKept);
+    mapOutpointIndex.erase(itOutpoint);
+    if(nOutpointIndex != nLastIndex) {
+        vecOutpoints[nOutpointIndex] = vecOutpoints[nLastIndex];
+        mapOutpointIndex[vecOutpoints[nOutpointIndex]] = nOutpointIndex;
     }
+    vecOutpoints.pop_back();
+
+    RebuildHashIndex();
 }
 
-void CGovernanceObjectVoteFile::RebuildIndex()
+void CGovernanceObjectVoteFile::Clear()
 {
-    mapVoteIndex.clear();
     nMemoryVotes = 0;
-    vote_l_it it = listVotes.begin();
-    while(it != listVotes.end()) {
-        CGovernanceVote& vote = *it;
-        uint256 nHash = vote.GetHash();
-        if(mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
-            mapVoteIndex[nHash] = it;
-            ++nMemoryVotes;
-            ++it;
-        }
-        else {
-            listVotes.erase(it++);
+    vecVotes.clear();
+    vecOutpoints.clear();
+    mapOutpointIndex.clear();
+    vecParentHashes.clear();
+    vchSigArena.clear();
+    vecHashIndex.clear();
+}
+
+CGovernanceVote CGovernanceObjectVoteFile::MakeVote(const CCompactVote& vote) const
+{
+    std::vector<unsigned char> vchSig(vchSigArena.begin() + vote.nSigOffset,
+                                      vchSigArena.begin() + vote.nSigOffset + vote.nSigSize);
+    return CGovernanceVote(vecOutpoints[vote.nOutpointIndex], vecParentHashes[vote.nParentIndex],
+                           vote.nVoteSignal, vote.nVoteOutcome, vote.nTime, vchSig, vote.nHash);
+}
+
+uint32_t CGovernanceObjectVoteFile::FindVote(const uint256& nHash) const
+{
+    if(vecHashIndex.empty()) {
+        return INDEX_EMPTY;
+    }
+    size_t nMask = vecHashIndex.size() - 1;
+    for(size_t nSlot = nHash.GetCheapHash() & nMask; vecHashIndex[nSlot] != INDEX_EMPTY; nSlot = (nSlot + 1) & nMask) {
+        if(vecVotes[vecHashIndex[nSlot]].nHash == nHash) {
+            return vecHashIndex[nSlot];
         }
     }
+    return INDEX_EMPTY;
+}
+
+void CGovernanceObjectVoteFile::InsertIntoHashIndex(uint32_t nPos)
+{
+    size_t nMask = vecHashIndex.size() - 1;
+    size_t nSlot = vecVotes[nPos].nHash.GetCheapHash() & nMask;
+    while(vecHashIndex[nSlot] != INDEX_EMPTY) {
+        nSlot = (nSlot + 1) & nMask;
+    }
+    vecHashIndex[nSlot] = nPos;
+}
+
+void CGovernanceObjectVoteFile::RebuildHashIndex()
+{
+    // the table size is a power of two, at least twice the number of votes
+    size_t nSize = 16;
+    while(nSize < 2 * vecVotes.size()) {
+        nSize *= 2;
+    }
+    vecHashIndex.assign(nSize, INDEX_EMPTY);
+    for(size_t nPos = 0; nPos < vecVotes.size(); ++nPos) {
+        InsertIntoHashIndex(uint32_t(nPos));
+    }
 }
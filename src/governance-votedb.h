@@ -5,14 +5,19 @@
 #ifndef GOVERNANCE_VOTEDB_H
 #define GOVERNANCE_VOTEDB_H
 
-#include <list>
 #include <map>
+#include <vector>
 
 #include "governance-vote.h"
 #include "serialize.h"
 #include "streams.h"
 #include "uint256.h"
 
+namespace governance_votedb_tests
+{
+    class TestVoteFile;
+}
+
 /**
  * Represents the collection of votes associated with a given CGovernanceObject
  * Recently received votes are held in memory until a maximum size is reached after
@@ -23,33 +28,49 @@
  */
 class CGovernanceObjectVoteFile
 {
-public: // Types
-    typedef std::list<CGovernanceVote> vote_l_t;
+    friend class governance_votedb_tests::TestVoteFile; // for test access to the outpoint slots
+
+private:
+    /**
+     * A vote without the data shared with the other votes of the file: the
+     * masternode outpoint and the parent hash are indexes into vecOutpoints
+     * and vecParentHashes, and the signature lives in vchSigArena.
+     */
+    struct CCompactVote {
+        uint256 nHash;
+        int64_t nTime;
+        uint32_t nOutpointIndex;
+        uint32_t nParentIndex;
+        uint32_t nSigOffset;
+        uint32_t nSigSize;
+        int32_t nVoteSignal;
+        int32_t nVoteOutcome;
+    };
 
-    typedef vote_l_t::iterator vote_l_it;
+    static const int MAX_MEMORY_VOTES = -1;
 
-    typedef vote_l_t::const_iterator vote_l_cit;
+    static const uint32_t INDEX_EMPTY = 0xffffffff;
 
-    typedef std::map<uint256,vote_l_it> vote_m_t;
+    int nMemoryVotes;
 
-    typedef vote_m_t::iterator vote_m_it;
+    // Votes in the order they were added, oldest first
+    std::vector<CCompactVote> vecVotes;
 
-    typedef vote_m_t::const_iterator vote_m_cit;
+    std::vector<COutPoint> vecOutpoints;
 
-private:
-    static const int MAX_MEMORY_VOTES = -1;
+    std::map<COutPoint, uint32_t> mapOutpointIndex;
 
-    int nMemoryVotes;
+    // Normally a single entry, the hash of the object the file belongs to
+    std::vector<uint256> vecParentHashes;
 
-    vote_l_t listVotes;
+    std::vector<unsigned char> vchSigArena;
 
-    vote_m_t mapVoteIndex;
+    // Open addressing hash table of positions in vecVotes, INDEX_EMPTY when unused
+    std::vector<uint32_t> vecHashIndex;
 
 public:
     CGovernanceObjectVoteFile();
 
-    CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other);
-
     /**
      * Add a vote to the file
      */
@@ -71,21 +92,52 @@ public:
 
     std::vector<CGovernanceVote> GetVotes() const;
 
+    std::vector<uint256> GetVoteHashes() const;
+
+    /**
+     * Retrieve up to nMax votes, newest first, following the vote with hash
+     * nAfterHash, or starting from the newest vote if nAfterHash is null.
+     * Return false if the vote with hash nAfterHash is no longer in the file.
+     */
+    bool GetVotesAfter(const uint256& nAfterHash, size_t nMax, std::vector<CGovernanceVote>& vecVotesRet) const;
+
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
 
-    ADD_SERIALIZE_METHODS;
+    // Stored as the list of votes, newest first, like before the compact format
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ::Serialize(s, nMemoryVotes);
+        WriteCompactSize(s, vecVotes.size());
+        for(std::vector<CCompactVote>::const_reverse_iterator it = vecVotes.rbegin(); it != vecVotes.rend(); ++it) {
+            ::Serialize(s, MakeVote(*it));
+        }
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action)
+    template <typename Stream>
+    void Unserialize(Stream& s)
     {
-        READWRITE(nMemoryVotes);
-        READWRITE(listVotes);
-        if(ser_action.ForRead()) {
-            RebuildIndex();
+        Clear();
+        int nMemoryVotesIn;
+        ::Unserialize(s, nMemoryVotesIn);
+        std::vector<CGovernanceVote> vecVotesIn;
+        ::Unserialize(s, vecVotesIn);
+        for(std::vector<CGovernanceVote>::const_reverse_iterator it = vecVotesIn.rbegin(); it != vecVotesIn.rend(); ++it) {
+            AddVote(*it);
         }
     }
+
 private:
-    void RebuildIndex();
+    void Clear();
+
+    CGovernanceVote MakeVote(const CCompactVote& vote) const;
+
+    /// Position of the vote in vecVotes, or INDEX_EMPTY
+    uint32_t FindVote(const uint256& nHash) const;
+
+    void InsertIntoHashIndex(uint32_t nPos);
+
+    void RebuildHashIndex();
 
 };
 
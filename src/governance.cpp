@@ -369,101 +369,105 @@ void CGovernanceManager::UpdateCachesAndClean()
     LogPrint("gobject", "CGovernanceManager::UpdateCachesAndClean\n");
 
     std::vector<uint256> vecDirtyHashes = mnodeman.GetAndClearDirtyGovernanceObjectHashes();
+    std::vector<uint256> vecObjectHashes;
 
-    LOCK2(cs_main, cs);
+    {
+        LOCK2(cs_main, cs);
 
-    for(size_t i = 0; i < vecDirtyHashes.size(); ++i) {
-        object_m_it it = mapObjects.find(vecDirtyHashes[i]);
-        if(it == mapObjects.end()) {
-            continue;
+        for(size_t i = 0; i < vecDirtyHashes.size(); ++i) {
+            object_m_it it = mapObjects.find(vecDirtyHashes[i]);
+            if(it == mapObjects.end()) {
+                continue;
+            }
+            it->second.ClearMasternodeVotes();
+            it->second.fDirtyCache = true;
         }
-        it->second.ClearMasternodeVotes();
-        it->second.fDirtyCache = true;
-    }
 
-    ScopedLockBool guard(cs, fRateChecksEnabled, false);
+        ScopedLockBool guard(cs, fRateChecksEnabled, false);
 
-    // Clean up any expired or invalid triggers
-    triggerman.CleanAndRemove();
+        // Clean up any expired or invalid triggers
+        triggerman.CleanAndRemove();
+
+        vecObjectHashes.reserve(mapObjects.size());
+        for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
+            vecObjectHashes.push_back(it->first);
+        }
+    }
 
-    object_m_it it = mapObjects.begin();
     int64_t nNow = GetAdjustedTime();
 
-    while(it != mapObjects.end())
-    {
-        CGovernanceObject* pObj = &((*it).second);
+    // Go through the objects a slice at a time, letting block and message
+    // processing have cs_main and cs in between
+    for(size_t nSliceStart = 0; nSliceStart < vecObjectHashes.size(); nSliceStart += CLEAN_SLICE_SIZE) {
+        LOCK2(cs_main, cs);
+        ScopedLockBool guard(cs, fRateChecksEnabled, false);
 
-        if(!pObj) {
-            ++it;
-            continue;
-        }
+        size_t nSliceEnd = std::min(vecObjectHashes.size(), nSliceStart + CLEAN_SLICE_SIZE);
+        for(size_t i = nSliceStart; i < nSliceEnd; ++i) {
+            object_m_it it = mapObjects.find(vecObjectHashes[i]);
+            if(it == mapObjects.end()) {
+                continue;
+            }
 
-        uint256 nHash = it->first;
-        std::string strHash = nHash.ToString();
+            CGovernanceObject* pObj = &((*it).second);
 
-        // IF CACHE IS NOT DIRTY, WHY DO THIS?
-        if(pObj->IsSetDirtyCache()) {
-            // UPDATE LOCAL VALIDITY AGAINST CRYPTO DATA
-            pObj->UpdateLocalValidity();
+            uint256 nHash = it->first;
+            std::string strHash = nHash.ToString();
 
-            // UPDATE SENTINEL SIGNALING VARIABLES
-            pObj->UpdateSentinelVariables();
-        }
+            // IF CACHE IS NOT DIRTY, WHY DO THIS?
+            if(pObj->IsSetDirtyCache()) {
+                // UPDATE LOCAL VALIDITY AGAINST CRYPTO DATA
+                pObj->UpdateLocalValidity();
 
-        // IF DELETE=TRUE, THEN CLEAN THE MESS UP!
+                // UPDATE SENTINEL SIGNALING VARIABLES
+                pObj->UpdateSentinelVariables();
+            }
 
-        int64_t nTimeSinceDeletion = nNow - pObj->GetDeletionTime();
+            // IF DELETE=TRUE, THEN CLEAN THE MESS UP!
 
-        LogPrint("gobject", "CGovernanceManager::UpdateCachesAndClean -- Checking object for deletion: %s, deletion time = %d, time since deletion = %d, delete flag = %d, expired flag = %d\n",
-                 strHash, pObj->GetDeletionTime(), nTimeSinceDeletion, pObj->IsSetCachedDelete(), pObj->IsSetExpired());
+            int64_t nTimeSinceDeletion = nNow - pObj->GetDeletionTime();
 
-        if((pObj->IsSetCachedDelete() || pObj->IsSetExpired()) &&
-           (nTimeSinceDeletion >= GOVERNANCE_DELETION_DELAY)) {
-            LogPrintf("CGovernanceManager::UpdateCachesAndClean -- erase obj %s\n", (*it).first.ToString());
-            mnodeman.RemoveGovernanceObject(pObj->GetHash());
+            LogPrint("gobject", "CGovernanceManager::UpdateCachesAndClean -- Checking object for deletion: %s, deletion time = %d, time since deletion = %d, delete flag = %d, expired flag = %d\n",
+                     strHash, pObj->GetDeletionTime(), nTimeSinceDeletion, pObj->IsSetCachedDelete(), pObj->IsSetExpired());
 
-            // Remove vote references
-            const object_ref_cm_t::list_t& listItems = cmapVoteToObject.GetItemList();
-            object_ref_cm_t::list_cit lit = listItems.begin();
-            while(lit != listItems.end()) {
-                if(lit->value == pObj) {
-                    uint256 nKey = lit->key;
-                    ++lit;
-                    cmapVoteToObject.Erase(nKey);
-                }
-                else {
-                    ++lit;
-                }
-            }
+            if((pObj->IsSetCachedDelete() || pObj->IsSetExpired()) &&
+               (nTimeSinceDeletion >= GOVERNANCE_DELETION_DELAY)) {
+                LogPrintf("CGovernanceManager::UpdateCachesAndClean -- erase obj %s\n", (*it).first.ToString());
+                mnodeman.RemoveGovernanceObject(pObj->GetHash());
 
-            int64_t nTimeExpired{0};
+                // Remove vote references
+                RemoveVoteReferences(pObj);
 
-            if(pObj->GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL) {
-                // keep hashes of deleted proposals forever
-                nTimeExpired = std::numeric_limits<int64_t>::max();
-            } else {
-                int64_t nSuperblockCycleSeconds = Params().GetConsensus().nSuperblockCycle * Params().GetConsensus().nPowTargetSpacing;
-                nTimeExpired = pObj->GetCreationTime() + 2 * nSuperblockCycleSeconds + GOVERNANCE_DELETION_DELAY;
-            }
+                int64_t nTimeExpired{0};
 
-            mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
-            mapObjects.erase(it++);
-        } else {
-            // NOTE: triggers are handled via triggerman
-            if (pObj->GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL) {
-                CProposalValidator validator(pObj->GetDataAsHexString());
-                if (!validator.Validate()) {
-                    LogPrintf("CGovernanceManager::UpdateCachesAndClean -- set for deletion expired obj %s\n", (*it).first.ToString());
-                    pObj->fCachedDelete = true;
-                    if (pObj->nDeletionTime == 0) {
-                        pObj->nDeletionTime = nNow;
+                if(pObj->GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL) {
+                    // keep hashes of deleted proposals forever
+                    nTimeExpired = std::numeric_limits<int64_t>::max();
+                } else {
+                    int64_t nSuperblockCycleSeconds = Params().GetConsensus().nSuperblockCycle * Params().GetConsensus().nPowTargetSpacing;
+                    nTimeExpired = pObj->GetCreationTime() + 2 * nSuperblockCycleSeconds + GOVERNANCE_DELETION_DELAY;
+                }
+
+                mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
+                mapObjects.erase(it);
+            } else {
+                // NOTE: triggers are handled via triggerman
+                if (pObj->GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL) {
+                    CProposalValidator validator(pObj->GetDataAsHexString());
+                    if (!validator.Validate()) {
+                        LogPrintf("CGovernanceManager::UpdateCachesAndClean -- set for deletion expired obj %s\n", (*it).first.ToString());
+                        pObj->fCachedDelete = true;
+                        if (pObj->nDeletionTime == 0) {
+                            pObj->nDeletionTime = nNow;
+                        }
                     }
                 }
             }
-            ++it;
         }
     }
 
+    LOCK(cs);
+
     // forget about expired deleted objects
     hash_time_m_it s_it = mapErasedGovernanceObjects.begin();
     while(s_it != mapErasedGovernanceObjects.end()) {
@@ -654,8 +658,6 @@ void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& n
     // do not provide any data until our node is synced
     if(!masternodeSync.IsSynced()) return;
 
-    int nVoteCount = 0;
-
     // SYNC GOVERNANCE OBJECTS WITH OTHER CLIENT
 
     LogPrint("gobject", "CGovernanceManager::%s -- syncing single object to peer=%d, nProp = %s\n", __func__, pnode->id, nProp.ToString());
@@ -679,25 +681,139 @@ void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& n
         return;
     }
 
+    // A repeated request restarts the vote sync with the peer's current filter
+    std::pair<NodeId, uint256> key(pnode->id, nProp);
+    mapVoteSyncs.erase(key);
+
+    size_t nPeerSyncs = 0;
+    vote_sync_m_it itSync = mapVoteSyncs.lower_bound(std::make_pair(pnode->id, uint256()));
+    while(itSync != mapVoteSyncs.end() && itSync->first.first == pnode->id) {
+        ++nPeerSyncs;
+        ++itSync;
+    }
+    if(nPeerSyncs >= GOVERNANCE_VOTE_SYNC_MAX_PER_PEER) {
+        LogPrint("gobject", "CGovernanceManager::%s -- too many vote syncs in progress, not syncing govobj: %s, peer=%d\n", __func__,
+                 strHash, pnode->id);
+        return;
+    }
+
     // Push the govobj inventory message over to the other client
     LogPrint("gobject", "CGovernanceManager::%s -- syncing govobj: %s, peer=%d\n", __func__, strHash, pnode->id);
     pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
 
-    auto fileVotes = govobj.GetVoteFile();
+    // Only the first chunk of votes is sent now, ProcessVoteSyncs sends the rest
+    CVoteSyncCursor cursor(filter, GetTime() + GOVERNANCE_VOTE_SYNC_TIMEOUT);
+    std::vector<uint256> vecVoteHashes;
+    bool fDone = StepVoteSync(govobj, cursor, GOVERNANCE_VOTE_SYNC_CHUNK_SIZE, vecVoteHashes);
 
-    for (const auto& vote : fileVotes.GetVotes()) {
-        uint256 nVoteHash = vote.GetHash();
-        if(filter.contains(nVoteHash) || !vote.IsValid(true)) {
-            continue;
-        }
+    for (const auto& nVoteHash : vecVoteHashes) {
         pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, nVoteHash));
-        ++nVoteCount;
     }
 
     CNetMsgMaker msgMaker(pnode->GetSendVersion());
     connman.PushMessage(pnode, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_GOVOBJ, 1));
-    connman.PushMessage(pnode, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_GOVOBJ_VOTE, nVoteCount));
-    LogPrintf("CGovernanceManager::%s -- sent 1 object and %d votes to peer=%d\n", __func__, nVoteCount, pnode->id);
+    if(fDone) {
+        connman.PushMessage(pnode, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_GOVOBJ_VOTE, cursor.nVoteCount));
+        LogPrintf("CGovernanceManager::%s -- sent 1 object and %d votes to peer=%d\n", __func__, cursor.nVoteCount, pnode->id);
+    } else {
+        mapVoteSyncs.emplace(key, cursor);
+        LogPrintf("CGovernanceManager::%s -- sent 1 object and the first %d votes to peer=%d\n", __func__, cursor.nVoteCount, pnode->id);
+    }
+}
+
+void CGovernanceManager::ProcessVoteSyncs(CConnman& connman)
+{
+    if(fLiteMode || !masternodeSync.IsSynced()) return;
+
+    std::vector<std::pair<NodeId, uint256> > vecKeys;
+    {
+        LOCK(cs);
+        for (const auto& syncpair : mapVoteSyncs) {
+            vecKeys.push_back(syncpair.first);
+        }
+    }
+
+    std::set<NodeId> setGonePeers;
+
+    // Take cs_main and cs per sync only, the signature checks of a chunk are not cheap
+    for (const auto& key : vecKeys) {
+        if(setGonePeers.count(key.first)) continue;
+
+        std::vector<uint256> vecVoteHashes;
+        bool fDone = false;
+        int nVoteCount = 0;
+        {
+            LOCK2(cs_main, cs);
+
+            vote_sync_m_it it = mapVoteSyncs.find(key);
+            if(it == mapVoteSyncs.end()) continue;
+            CVoteSyncCursor& cursor = it->second;
+
+            object_m_it itObj = mapObjects.find(key.second);
+            if(cursor.nTimeExpire < GetTime() || itObj == mapObjects.end() ||
+               itObj->second.IsSetCachedDelete() || itObj->second.IsSetExpired()) {
+                LogPrint("gobject", "CGovernanceManager::%s -- dropping vote sync of %s, peer=%d\n", __func__, key.second.ToString(), key.first);
+                mapVoteSyncs.erase(it);
+                continue;
+            }
+
+            fDone = StepVoteSync(itObj->second, cursor, GOVERNANCE_VOTE_SYNC_CHUNK_SIZE, vecVoteHashes);
+            nVoteCount = cursor.nVoteCount;
+            if(fDone) {
+                mapVoteSyncs.erase(it);
+            }
+        }
+
+        bool fFound = connman.ForNode(key.first, [&](CNode* pnode) {
+            for (const auto& nVoteHash : vecVoteHashes) {
+                pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, nVoteHash));
+            }
+            if(fDone) {
+                CNetMsgMaker msgMaker(pnode->GetSendVersion());
+                connman.PushMessage(pnode, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_GOVOBJ_VOTE, nVoteCount));
+                LogPrintf("CGovernanceManager::%s -- sent %d votes of %s to peer=%d\n", __func__, nVoteCount, key.second.ToString(), key.first);
+            }
+            return true;
+        });
+
+        if(!fFound) {
+            setGonePeers.insert(key.first);
+        }
+    }
+
+    if(setGonePeers.empty()) return;
+
+    LOCK(cs);
+    vote_sync_m_it it = mapVoteSyncs.begin();
+    while(it != mapVoteSyncs.end()) {
+        if(setGonePeers.count(it->first.first)) {
+            mapVoteSyncs.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool CGovernanceManager::StepVoteSync(const CGovernanceObject& govobj, CVoteSyncCursor& cursor, size_t nMax, std::vector<uint256>& vecVoteHashesRet)
+{
+    AssertLockHeld(cs);
+
+    std::vector<CGovernanceVote> vecVotes;
+    if(!govobj.GetVoteFile().GetVotesAfter(cursor.nLastVoteHash, nMax, vecVotes)) {
+        // Starting over would resend the votes already sent, end the sync instead
+        LogPrint("gobject", "CGovernanceManager::%s -- last vote sent is gone, ending vote sync of %s\n", __func__, govobj.GetHash().ToString());
+        return true;
+    }
+    for (const auto& vote : vecVotes) {
+        uint256 nVoteHash = vote.GetHash();
+        cursor.nLastVoteHash = nVoteHash;
+        if(cursor.filter.contains(nVoteHash) || !vote.IsValid(true)) {
+            continue;
+        }
+        vecVoteHashesRet.push_back(nVoteHash);
+        ++cursor.nVoteCount;
+    }
+    return vecVotes.size() < nMax;
 }
 
 void CGovernanceManager::SyncAll(CNode* pnode, CConnman& connman) const
@@ -712,7 +828,10 @@ void CGovernanceManager::SyncAll(CNode* pnode, CConnman& connman) const
         Misbehaving(pnode->GetId(), 20);
         return;
     }
-    netfulfilledman.AddFulfilledRequest(pnode->addr, NetMsgType::MNGOVERNANCESYNC);
+    if(!netfulfilledman.AddFulfilledRequest(pnode->addr, NetMsgType::MNGOVERNANCESYNC)) {
+        // can't remember the request, so don't serve it either
+        return;
+    }
 
     int nObjCount = 0;
     int nVoteCount = 0;
@@ -893,7 +1012,7 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
         return false;
     }
 
-    bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman) && cmapVoteToObject.Insert(nHashVote, &govobj);
+    bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman) && AddVoteReference(nHashVote, &govobj);
     LEAVE_CRITICAL_SECTION(cs);
     return fOk;
 }
@@ -1037,10 +1156,10 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
 
         if(pObj) {
             filter = CBloomFilter(Params().GetConsensus().nGovernanceFilterElements, GOVERNANCE_FILTER_FP_RATE, GetRandInt(2412699), BLOOM_UPDATE_ALL);
-            std::vector<CGovernanceVote> vecVotes = pObj->GetVoteFile().GetVotes();
-            nVoteCount = vecVotes.size();
-            for(size_t i = 0; i < vecVotes.size(); ++i) {
-                filter.insert(vecVotes[i].GetHash());
+            std::vector<uint256> vecVoteHashes = pObj->GetVoteFile().GetVoteHashes();
+            nVoteCount = vecVoteHashes.size();
+            for(size_t i = 0; i < vecVoteHashes.size(); ++i) {
+                filter.insert(vecVoteHashes[i]);
             }
         }
     }
@@ -1188,13 +1307,56 @@ void CGovernanceManager::RebuildIndexes()
     LOCK(cs);
 
     cmapVoteToObject.Clear();
+    mapObjectVoteHashes.clear();
     for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
         CGovernanceObject& govobj = it->second;
-        std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-        for(size_t i = 0; i < vecVotes.size(); ++i) {
-            cmapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
+        std::vector<uint256> vecVoteHashes = govobj.GetVoteFile().GetVoteHashes();
+        for(size_t i = 0; i < vecVoteHashes.size(); ++i) {
+            AddVoteReference(vecVoteHashes[i], &govobj);
+        }
+    }
+}
+
+bool CGovernanceManager::AddVoteReference(const uint256& nHashVote, CGovernanceObject* pGovobj)
+{
+    AssertLockHeld(cs);
+
+    if(cmapVoteToObject.HasKey(nHashVote)) {
+        return false;
+    }
+    // The cache is full and will prune its oldest entry, forget that hash in
+    // the set of its object too so the sets stay bounded by the cache size
+    if(cmapVoteToObject.GetSize() > 0 && cmapVoteToObject.GetSize() == cmapVoteToObject.GetMaxSize()) {
+        const object_ref_cm_t::item_t& itemOldest = cmapVoteToObject.GetItemList().back();
+        std::map<uint256, hash_s_t>::iterator it = mapObjectVoteHashes.find(itemOldest.value->GetHash());
+        if(it != mapObjectVoteHashes.end()) {
+            it->second.erase(itemOldest.key);
+            if(it->second.empty()) {
+                mapObjectVoteHashes.erase(it);
+            }
+        }
+    }
+    cmapVoteToObject.Insert(nHashVote, pGovobj);
+    mapObjectVoteHashes[pGovobj->GetHash()].insert(nHashVote);
+    return true;
+}
+
+void CGovernanceManager::RemoveVoteReferences(CGovernanceObject* pGovobj)
+{
+    AssertLockHeld(cs);
+
+    std::map<uint256, hash_s_t>::iterator it = mapObjectVoteHashes.find(pGovobj->GetHash());
+    if(it == mapObjectVoteHashes.end()) {
+        return;
+    }
+    // Only drop the entries still pointing at this object
+    for(hash_s_cit vit = it->second.begin(); vit != it->second.end(); ++vit) {
+        CGovernanceObject* pVoteObj = NULL;
+        if(cmapVoteToObject.Get(*vit, pVoteObj) && pVoteObj == pGovobj) {
+            cmapVoteToObject.Erase(*vit);
         }
     }
+    mapObjectVoteHashes.erase(it);
 }
 
 void CGovernanceManager::AddCachedTriggers()
@@ -26,6 +26,11 @@ class CGovernanceTriggerManager;
 class CGovernanceObject;
 class CGovernanceVote;
 
+namespace governance_tests
+{
+    class TestGovernanceManager;
+}
+
 extern CGovernanceManager governance;
 
 struct ExpirationInfo {
@@ -37,6 +42,32 @@ struct ExpirationInfo {
 
 typedef std::pair<CGovernanceObject, ExpirationInfo> object_info_pair_t;
 
+// Votes of an object looked at per step of a vote sync to a peer
+static const size_t GOVERNANCE_VOTE_SYNC_CHUNK_SIZE = 500;
+// Vote syncs in progress per peer, further requests of the peer are refused
+static const size_t GOVERNANCE_VOTE_SYNC_MAX_PER_PEER = 4;
+// Seconds a vote sync may take before it is dropped
+static const int64_t GOVERNANCE_VOTE_SYNC_TIMEOUT = 10 * 60;
+
+/**
+ * Progress of the vote sync of a single object to a peer. The votes are sent
+ * in chunks, each resuming after the last vote looked at, and the filter of
+ * the request is kept to skip the votes the peer already has.
+ */
+struct CVoteSyncCursor {
+    CVoteSyncCursor(const CBloomFilter& filterIn, int64_t nTimeExpireIn)
+        : filter(filterIn),
+          nLastVoteHash(),
+          nTimeExpire(nTimeExpireIn),
+          nVoteCount(0)
+        {}
+
+    CBloomFilter filter;
+    uint256 nLastVoteHash;
+    int64_t nTimeExpire;
+    int nVoteCount;
+};
+
 static const int RATE_BUFFER_SIZE = 5;
 
 class CRateCheckBuffer
@@ -150,6 +181,7 @@ public:
 class CGovernanceManager
 {
     friend class CGovernanceObject;
+    friend class governance_tests::TestGovernanceManager; // for test access to the vote references
 
 public: // Types
     struct last_object_rec {
@@ -218,9 +250,16 @@ public: // Types
 
     typedef hash_time_m_t::const_iterator hash_time_m_cit;
 
+    typedef std::map<std::pair<NodeId, uint256>, CVoteSyncCursor> vote_sync_m_t;
+
+    typedef vote_sync_m_t::iterator vote_sync_m_it;
+
 private:
     static const int MAX_CACHE_SIZE = 1000000;
 
+    // Objects checked by UpdateCachesAndClean per hold of cs_main and cs
+    static const size_t CLEAN_SLICE_SIZE = 100;
+
     static const std::string SERIALIZATION_VERSION_STRING;
 
     static const int MAX_TIME_FUTURE_DEVIATION;
@@ -247,6 +286,11 @@ private:
 
     object_ref_cm_t cmapVoteToObject;
 
+    // Hashes of the votes in cmapVoteToObject, by object hash, so that the
+    // references to an object can be dropped without walking the cache.
+    // Hashes pruned from the cache are removed here as well
+    std::map<uint256, hash_s_t> mapObjectVoteHashes;
+
     vote_cm_t cmapInvalidVotes;
 
     vote_cmm_t cmmapOrphanVotes;
@@ -257,6 +301,9 @@ private:
 
     hash_s_t setRequestedVotes;
 
+    // Vote syncs to peers in progress, by peer and object hash
+    vote_sync_m_t mapVoteSyncs;
+
     bool fRateChecksEnabled;
 
     class ScopedLockBool
@@ -296,6 +343,9 @@ public:
     void SyncSingleObjAndItsVotes(CNode* pnode, const uint256& nProp, const CBloomFilter& filter, CConnman& connman);
     void SyncAll(CNode* pnode, CConnman& connman) const;
 
+    /// Send the next chunk of votes of every vote sync in progress
+    void ProcessVoteSyncs(CConnman& connman);
+
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 
     void DoMaintenance(CConnman& connman);
@@ -321,9 +371,11 @@ public:
         mapObjects.clear();
         mapErasedGovernanceObjects.clear();
         cmapVoteToObject.Clear();
+        mapObjectVoteHashes.clear();
         cmapInvalidVotes.Clear();
         cmmapOrphanVotes.Clear();
         mapLastMasternodeObject.clear();
+        mapVoteSyncs.clear();
     }
 
     std::string ToString() const;
@@ -412,6 +464,13 @@ public:
     int RequestGovernanceObjectVotes(const std::vector<CNode*>& vNodesCopy, CConnman& connman);
 
 private:
+    /**
+     * Look at the next nMax votes of a vote sync, adding the ones to send to
+     * vecVoteHashesRet. Returns true once all votes were looked at, or when
+     * the last vote looked at was removed and the sync can't be resumed.
+     */
+    bool StepVoteSync(const CGovernanceObject& govobj, CVoteSyncCursor& cursor, size_t nMax, std::vector<uint256>& vecVoteHashesRet);
+
     void RequestGovernanceObject(CNode* pfrom, const uint256& nHash, CConnman& connman, bool fUseFilter = false);
 
     void AddInvalidVote(const CGovernanceVote& vote)
@@ -438,6 +497,11 @@ private:
 
     void RebuildIndexes();
 
+    /// Remember that vote nHashVote belongs to pGovobj, returns false if it was known
+    bool AddVoteReference(const uint256& nHashVote, CGovernanceObject* pGovobj);
+    /// Forget the votes of pGovobj before it is erased
+    void RemoveVoteReferences(CGovernanceObject* pGovobj);
+
     void AddCachedTriggers();
 
     void RequestOrphanObjects(CConnman& connman);
@@ -243,14 +243,18 @@ void PrepareShutdown()
 
     // STORE DATA CACHES INTO SERIALIZED DAT FILES
     if (!fLiteMode) {
+        // Nothing else touches the caches any more, and each one only takes
+        // its own lock to serialize, so the large ones are written in parallel
+        CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
+        boost::thread threadGovernanceDump(boost::bind(&CFlatDB<CGovernanceManager>::Dump, &flatdb3, boost::ref(governance)));
+        CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
+        boost::thread threadPaymentsDump(boost::bind(&CFlatDB<CMasternodePayments>::Dump, &flatdb2, boost::ref(mnpayments)));
         CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
         flatdb1.Dump(mnodeman);
-        CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
-        flatdb2.Dump(mnpayments);
-        CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
-        flatdb3.Dump(governance);
         CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
         flatdb4.Dump(netfulfilledman);
+        threadPaymentsDump.join();
+        threadGovernanceDump.join();
     }
 
     UnregisterNodeSignals(GetNodeSignals());
@@ -335,6 +339,7 @@ void Shutdown()
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    StopDebugLogWriter();
 }
 
 /**
@@ -512,7 +517,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-bip9params=deployment:start:end", "Use given start/end times for specified BIP9 deployment (regtest-only)");
     }
-    std::string debugCategories = "addrman, alert, bench, cmpctblock, coindb, db, http, leveldb, libevent, lock, mempool, mempoolrej, net, proxy, prune, rand, reindex, rpc, selectcoins, tor, zmq, "
+    std::string debugCategories = "addrman, alert, bench, cmpctblock, coindb, db, http, leveldb, libevent, lock, mempool, mempoolrej, net, proxy, prune, rand, reindex, rpc, selectcoins, staking, tor, zmq, "
                                   "polis (or specifically: gobject, instantsend, keepass, masternode, mnpayments, mnsync, privatesend, spork)"; // Don't translate these and qt below
     if (mode == HMM_BITCOIN_QT)
         debugCategories += ", qt";
@@ -521,11 +526,14 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-nodebug", "Turn off debugging messages, same as -debug=0");
     strUsage += HelpMessageOpt("-help-debug", _("Show all debugging options (usage: --help -help-debug)"));
+    strUsage += HelpMessageOpt("-debugratelimit=<n>", strprintf(_("Drop debugging messages of a category beyond <n> per second, 0 = unlimited (default: %u)"), DEFAULT_LOGRATELIMIT));
     strUsage += HelpMessageOpt("-logips", strprintf(_("Include IP addresses in debug output (default: %u)"), DEFAULT_LOGIPS));
     strUsage += HelpMessageOpt("-logtimestamps", strprintf(_("Prepend debug output with timestamp (default: %u)"), DEFAULT_LOGTIMESTAMPS));
     if (showDebug)
     {
         strUsage += HelpMessageOpt("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS));
+        strUsage += HelpMessageOpt("-logasync", strprintf("Write debug.log from a background thread (default: %u)", DEFAULT_LOGASYNC));
+        strUsage += HelpMessageOpt("-lockstats", strprintf("Record how long each LOCK site waits for and holds its lock, see getlockstats (default: %u)", DEFAULT_LOCKSTATS));
         strUsage += HelpMessageOpt("-logthreadnames", strprintf("Add thread names to debug messages (default: %u)", DEFAULT_LOGTHREADNAMES));
         strUsage += HelpMessageOpt("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)");
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", DEFAULT_LIMITFREERELAY));
@@ -553,6 +561,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-mnconf=<file>", strprintf(_("Specify masternode configuration file (default: %s)"), "masternode.conf"));
     strUsage += HelpMessageOpt("-mnconflock=<n>", strprintf(_("Lock masternodes from masternode configuration file (default: %u)"), 1));
     strUsage += HelpMessageOpt("-masternodeprivkey=<n>", _("Set the masternode private key"));
+    strUsage += HelpMessageOpt("-maxseenpings=<n>", strprintf(_("Remember at most <n> unexpired masternode pings (default: %u)"), DEFAULT_MAX_SEEN_PINGS));
+    strUsage += HelpMessageOpt("-maxfulfilledrequests=<n>", strprintf(_("Remember at most <n> unexpired requests served to or sent to peers (default: %u)"), DEFAULT_MAX_FULFILLED_REQUESTS));
 
 #ifdef ENABLE_WALLET
     strUsage += HelpMessageGroup(_("PrivateSend options:"));
@@ -939,6 +949,7 @@ void InitLogging()
     fLogTimeMicros = GetBoolArg("-logtimemicros", DEFAULT_LOGTIMEMICROS);
     fLogThreadNames = GetBoolArg("-logthreadnames", DEFAULT_LOGTHREADNAMES);
     fLogIPs = GetBoolArg("-logips", DEFAULT_LOGIPS);
+    nLogRateLimit = std::max((int64_t)0, GetArg("-debugratelimit", DEFAULT_LOGRATELIMIT));
 
     LogPrintf("\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n");
     LogPrintf("Polis Core version %s\n", FormatFullVersion());
@@ -1103,6 +1114,7 @@ bool AppInitParameterInteraction()
         mempool.setSanityCheck(1.0 / ratio);
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
+    fLockStats = GetBoolArg("-lockstats", DEFAULT_LOCKSTATS);
     fCheckpointsEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
 
     hashAssumeValid = uint256S(GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
@@ -1880,6 +1892,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // LOAD SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
 
+    mnodeman.SetMaxSeenPings(std::max<int64_t>(1, GetArg("-maxseenpings", DEFAULT_MAX_SEEN_PINGS)));
+    netfulfilledman.SetMaxSize(std::max<int64_t>(1, GetArg("-maxfulfilledrequests", DEFAULT_MAX_FULFILLED_REQUESTS)));
+
     if (!fLiteMode) {
         boost::filesystem::path pathDB = GetDataDir();
         std::string strDBName;
@@ -1892,19 +1907,25 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
 
         if(mnodeman.size()) {
-            strDBName = "mnpayments.dat";
-            uiInterface.InitMessage(_("Loading masternode payment cache..."));
-            CFlatDB<CMasternodePayments> flatdb2(strDBName, "magicMasternodePaymentsCache");
-            if(!flatdb2.Load(mnpayments)) {
-                return InitError(_("Failed to load masternode payments cache from") + "\n" + (pathDB / strDBName).string());
+            // Read and deserialize the payment votes while the governance
+            // cache loads, then clean both up one after the other
+            uiInterface.InitMessage(_("Loading masternode payment and governance caches..."));
+            bool fPaymentsLoaded = false;
+            CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
+            boost::thread threadPaymentsLoad([&flatdb2, &fPaymentsLoaded] { fPaymentsLoaded = flatdb2.Load(mnpayments, false); });
+
+            CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
+            bool fGovernanceLoaded = flatdb3.Load(governance, false);
+            threadPaymentsLoad.join();
+
+            if(!fPaymentsLoaded) {
+                return InitError(_("Failed to load masternode payments cache from") + "\n" + (pathDB / "mnpayments.dat").string());
             }
-
-            strDBName = "governance.dat";
-            uiInterface.InitMessage(_("Loading governance cache..."));
-            CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
-            if(!flatdb3.Load(governance)) {
-                return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / strDBName).string());
+            if(!fGovernanceLoaded) {
+                return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / "governance.dat").string());
             }
+            mnpayments.CheckAndRemove();
+            governance.CheckAndRemove();
             governance.InitOnLoad();
         } else {
             uiInterface.InitMessage(_("Masternode cache is empty, skipping payments and governance cache..."));
@@ -28,6 +28,13 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeMod
 bool CheckStakeKernelHash(unsigned int nBits, const CBlock& blockFrom, unsigned int nTxPrevOffset,
                           const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx,
                           uint256& hashProofOfStake);
+// Same check from the stake modifier and time of the block the staked output
+// is in, so that it can be evaluated without cs_main
+bool CheckStakeKernelHash(unsigned int nBits, int64_t nBlockFromTime, uint64_t nStakeModifier,
+                          unsigned int nTxPrevOffset, CAmount nValueIn, const COutPoint& prevout,
+                          unsigned int nTimeTx, uint256& hashProofOfStake);
+// Get the stake modifier a kernel staking an output of block hashBlockFrom is hashed with
+bool GetKernelStakeModifier(const uint256& hashBlockFrom, unsigned int nTimeTx, uint64_t& nStakeModifier);
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
 bool CheckProofOfStake(const CBlock &block, uint256& hashProofOfStake);
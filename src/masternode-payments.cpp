@@ -233,20 +233,28 @@ void CMasternodePayments::Clear()
     mapMasternodePaymentVotes.clear();
 }
 
-bool CMasternodePayments::UpdateLastVote(const CMasternodePaymentVote& vote)
+bool CMasternodePayments::UpdateLastVote(const CMasternodePaymentVote& vote, uint32_t nMasternodeId, uint32_t nMasternodeIdSerial)
 {
     LOCK(cs_mapMasternodePaymentVotes);
 
-    const auto it = mapMasternodesLastVote.find(vote.masternodeOutpoint);
-    if (it != mapMasternodesLastVote.end()) {
-        if (it->second == vote.nBlockHeight)
-            return false;
-        it->second = vote.nBlockHeight;
-        return true;
+    // masternodes known to mnodeman always have an id
+    if (nMasternodeId == MASTERNODE_ID_NONE)
+        return false;
+
+    if (nMasternodeId >= vecMasternodesLastVote.size())
+        vecMasternodesLastVote.resize(nMasternodeId + 1, std::make_pair(0u, 0));
+
+    std::pair<uint32_t, int>& lastVote = vecMasternodesLastVote[nMasternodeId];
+    if (lastVote.first != nMasternodeIdSerial) {
+        // the id was reused, forget the vote of the masternode which had it before
+        lastVote = std::make_pair(nMasternodeIdSerial, 0);
     }
 
+    if (lastVote.second == vote.nBlockHeight)
+        return false;
+
     //record this masternode voted
-    mapMasternodesLastVote.emplace(vote.masternodeOutpoint, vote.nBlockHeight);
+    lastVote.second = vote.nBlockHeight;
     return true;
 }
 
@@ -326,7 +334,10 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, const std::string& strCom
             Misbehaving(pfrom->GetId(), 20);
             return;
         }
-        netfulfilledman.AddFulfilledRequest(pfrom->addr, NetMsgType::MASTERNODEPAYMENTSYNC);
+        if(!netfulfilledman.AddFulfilledRequest(pfrom->addr, NetMsgType::MASTERNODEPAYMENTSYNC)) {
+            // can't remember the request, so don't serve it either
+            return;
+        }
 
         Sync(pfrom, connman);
         LogPrintf("MASTERNODEPAYMENTSYNC -- Sent Masternode payment votes to peer=%d\n", pfrom->id);
@@ -408,7 +419,7 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, const std::string& strCom
             return;
         }
 
-        if(!UpdateLastVote(vote)) {
+        if(!UpdateLastVote(vote, mnInfo.nId, mnInfo.nIdSerial)) {
             LogPrintf("MASTERNODEPAYMENTVOTE -- masternode already voted, masternode=%s\n", vote.masternodeOutpoint.ToStringShort());
             return;
         }
@@ -190,7 +190,9 @@ private:
 public:
     std::map<uint256, CMasternodePaymentVote> mapMasternodePaymentVotes;
     std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
-    std::map<COutPoint, int> mapMasternodesLastVote;
+    // id serial of the masternode and height of the last block it voted for, by masternode id.
+    // Ids of removed masternodes are reused, a slot of another masternode starts over.
+    std::vector<std::pair<uint32_t, int> > vecMasternodesLastVote;
     std::map<COutPoint, int> mapMasternodesDidNotVote;
 
     CMasternodePayments() : nStorageCoeff(1.25), nMinBlocksToStore(6000) {}
@@ -218,7 +220,7 @@ public:
     bool IsTransactionValid(const CTransactionRef& txNew, int nBlockHeight);
     bool IsScheduled(const masternode_info_t& mnInfo, int nNotBlockHeight) const;
 
-    bool UpdateLastVote(const CMasternodePaymentVote& vote);
+    bool UpdateLastVote(const CMasternodePaymentVote& vote, uint32_t nMasternodeId, uint32_t nMasternodeIdSerial);
 
     int GetMinMasternodePaymentsProto() const;
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
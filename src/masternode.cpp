@@ -70,7 +70,7 @@ bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb, CConnman& co
     int nDos = 0;
     if(!mnb.lastPing || (mnb.lastPing && mnb.lastPing.CheckAndUpdate(this, true, nDos, connman))) {
         lastPing = mnb.lastPing;
-        mnodeman.mapSeenMasternodePing.insert(std::make_pair(lastPing.GetHash(), lastPing));
+        mnodeman.AddSeenPing(lastPing);
     }
     // if it matches our Masternode privkey...
     if(fMasternodeMode && pubKeyMasternode == activeMasternode.pubKeyMasternode) {
@@ -518,7 +518,7 @@ bool CMasternodeBroadcast::Update(CMasternode* pmn, int& nDos, CConnman& connman
         return false;
     }
 
-    if (!CheckSignature(nDos)) {
+    if (!fSignatureVerified && !CheckSignature(nDos)) {
         LogPrintf("CMasternodeBroadcast::Update -- CheckSignature() failed, masternode=%s\n", outpoint.ToStringShort());
         return false;
     }
@@ -587,7 +587,7 @@ bool CMasternodeBroadcast::CheckOutpoint(int& nDos)
         return false;
     }
 
-    if (!CheckSignature(nDos)) {
+    if (!fSignatureVerified && !CheckSignature(nDos)) {
         LogPrintf("CMasternodeBroadcast::CheckOutpoint -- CheckSignature() failed, masternode=%s\n", outpoint.ToStringShort());
         return false;
     }
@@ -695,6 +695,15 @@ bool CMasternodeBroadcast::CheckSignature(int& nDos) const
     return true;
 }
 
+void CMasternodeBroadcast::VerifySignatures(bool fWithPing)
+{
+    int nDos = 0;
+    fSignatureVerified = CheckSignature(nDos);
+    if(fWithPing && lastPing) {
+        lastPing.fSignatureVerified = lastPing.CheckSignature(pubKeyMasternode, nDos);
+    }
+}
+
 void CMasternodeBroadcast::Relay(CConnman& connman) const
 {
     // Do not relay until fully synced
@@ -885,7 +894,8 @@ bool CMasternodePing::CheckAndUpdate(CMasternode* pmn, bool fFromNewBroadcast, i
         return false;
     }
 
-    if (!CheckSignature(pmn->pubKeyMasternode, nDos)) return false;
+    // a ping verified ahead came with a broadcast and was checked against its pubKeyMasternode, which pmn has taken over
+    if (!fSignatureVerified && !CheckSignature(pmn->pubKeyMasternode, nDos)) return false;
 
     // so, ping seems to be ok
 
@@ -22,6 +22,9 @@ static const int MASTERNODE_NEW_START_REQUIRED_SECONDS  = 180 * 60;
 
 static const int MASTERNODE_POSE_BAN_MAX_SCORE          = 5;
 
+// Id of a masternode which wasn't added to CMasternodeMan
+static const uint32_t MASTERNODE_ID_NONE = 0xffffffff;
+
 //
 // The Masternode Ping Class : Contains a different serialize method for sending pings from masternodes throughout the network
 //
@@ -42,6 +45,8 @@ public:
     // MSB is always 0, other 3 bits corresponds to x.x.x version scheme
     uint32_t nSentinelVersion{DEFAULT_SENTINEL_VERSION};
     uint32_t nDaemonVersion{DEFAULT_DAEMON_VERSION};
+    // signature was verified ahead of CheckAndUpdate, not serialized
+    bool fSignatureVerified = false;
 
     CMasternodePing() = default;
 
@@ -93,7 +98,8 @@ public:
     uint256 GetHash() const;
     uint256 GetSignatureHash() const;
 
-    bool IsExpired() const { return GetAdjustedTime() - sigTime > MASTERNODE_NEW_START_REQUIRED_SECONDS; }
+    int64_t GetExpireTime() const { return sigTime + MASTERNODE_NEW_START_REQUIRED_SECONDS; }
+    bool IsExpired() const { return GetAdjustedTime() > GetExpireTime(); }
 
     bool Sign(const CKey& keyMasternode, const CPubKey& pubKeyMasternode);
     bool CheckSignature(const CPubKey& pubKeyMasternode, int &nDos) const;
@@ -148,6 +154,11 @@ struct masternode_info_t
     int64_t nTimeLastPaid = 0;
     int64_t nTimeLastPing = 0; //* not in CMN
     bool fInfoValid = false; //* not in CMN
+
+    // dense index assigned by CMasternodeMan, stable for the session only
+    uint32_t nId = MASTERNODE_ID_NONE; //* not serialized
+    // tells apart the masternodes which held the same nId this session, never 0
+    uint32_t nIdSerial = 0; //* not serialized
 };
 
 //
@@ -350,11 +361,13 @@ class CMasternodeBroadcast : public CMasternode
 public:
 
     bool fRecovery;
+    // signature was verified ahead of CheckOutpoint/Update, not serialized
+    bool fSignatureVerified;
 
-    CMasternodeBroadcast() : CMasternode(), fRecovery(false) {}
-    CMasternodeBroadcast(const CMasternode& mn) : CMasternode(mn), fRecovery(false) {}
+    CMasternodeBroadcast() : CMasternode(), fRecovery(false), fSignatureVerified(false) {}
+    CMasternodeBroadcast(const CMasternode& mn) : CMasternode(mn), fRecovery(false), fSignatureVerified(false) {}
     CMasternodeBroadcast(CService addrNew, COutPoint outpointNew, CPubKey pubKeyCollateralAddressNew, CPubKey pubKeyMasternodeNew, int nProtocolVersionIn) :
-        CMasternode(addrNew, outpointNew, pubKeyCollateralAddressNew, pubKeyMasternodeNew, nProtocolVersionIn), fRecovery(false) {}
+        CMasternode(addrNew, outpointNew, pubKeyCollateralAddressNew, pubKeyMasternodeNew, nProtocolVersionIn), fRecovery(false), fSignatureVerified(false) {}
 
     ADD_SERIALIZE_METHODS;
 
@@ -401,6 +414,12 @@ public:
 
     bool Sign(const CKey& keyCollateralAddress);
     bool CheckSignature(int& nDos) const;
+    /**
+     * Verify the signature, and the one of lastPing if fWithPing, without any locks held
+     * and remember the outcome, so that CheckOutpoint/Update and the ping's CheckAndUpdate
+     * can skip it. Failures are left for them to detect and penalize as usual.
+     */
+    void VerifySignatures(bool fWithPing);
     void Relay(CConnman& connman) const;
 };
 
@@ -24,7 +24,7 @@
 /** Masternode manager */
 CMasternodeMan mnodeman;
 
-const std::string CMasternodeMan::SERIALIZATION_VERSION_STRING = "CMasternodeMan-Version-8";
+const std::string CMasternodeMan::SERIALIZATION_VERSION_STRING = "CMasternodeMan-Version-9";
 const int CMasternodeMan::LAST_PAID_SCAN_BLOCKS = 100;
 
 struct CompareLastPaidBlock
@@ -45,22 +45,16 @@ struct CompareScoreMN
     }
 };
 
-struct CompareByAddr
-
-{
-    bool operator()(const CMasternode* t1,
-                    const CMasternode* t2) const
-    {
-        return t1->addr < t2->addr;
-    }
-};
-
 CMasternodeMan::CMasternodeMan():
     cs(),
     mapMasternodes(),
-    mAskedUsForMasternodeList(),
-    mWeAskedForMasternodeList(),
-    mWeAskedForMasternodeListEntry(),
+    vecFreeIds(),
+    nNextId(0),
+    nLastIdSerial(0),
+    mapMasternodesByAddr(),
+    mAskedUsForMasternodeList(MAX_LIST_REQUESTS),
+    mWeAskedForMasternodeList(MAX_LIST_REQUESTS),
+    mWeAskedForMasternodeListEntry(MAX_LIST_ENTRY_REQUESTS),
     mWeAskedForVerification(),
     mMnbRecoveryRequests(),
     mMnbRecoveryGoodReplies(),
@@ -70,7 +64,7 @@ CMasternodeMan::CMasternodeMan():
     vecDirtyGovernanceObjectHashes(),
     nLastSentinelPingTime(0),
     mapSeenMasternodeBroadcast(),
-    mapSeenMasternodePing(),
+    mapSeenMasternodePing(DEFAULT_MAX_SEEN_PINGS),
     nDsqCount(0)
 {}
 
@@ -81,11 +75,57 @@ bool CMasternodeMan::Add(CMasternode &mn)
     if (Has(mn.outpoint)) return false;
 
     LogPrint("masternode", "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
-    mapMasternodes[mn.outpoint] = mn;
+    CMasternode& mnNew = mapMasternodes[mn.outpoint];
+    mnNew = mn;
+    AssignId(mnNew);
+    AddToAddrIndex(&mnNew);
     fMasternodesAdded = true;
     return true;
 }
 
+void CMasternodeMan::AssignId(CMasternode& mn)
+{
+    AssertLockHeld(cs);
+
+    if (vecFreeIds.empty()) {
+        mn.nId = nNextId++;
+    } else {
+        mn.nId = vecFreeIds.back();
+        vecFreeIds.pop_back();
+    }
+    if (++nLastIdSerial == 0) {
+        ++nLastIdSerial;
+    }
+    mn.nIdSerial = nLastIdSerial;
+}
+
+void CMasternodeMan::ReleaseId(uint32_t nId)
+{
+    AssertLockHeld(cs);
+
+    if (nId != MASTERNODE_ID_NONE) {
+        vecFreeIds.push_back(nId);
+    }
+}
+
+void CMasternodeMan::AddToAddrIndex(CMasternode* pmn)
+{
+    AssertLockHeld(cs);
+    mapMasternodesByAddr.emplace(pmn->addr, pmn);
+}
+
+void CMasternodeMan::RemoveFromAddrIndex(const CService& addr, const CMasternode* pmn)
+{
+    AssertLockHeld(cs);
+    auto range = mapMasternodesByAddr.equal_range(addr);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == pmn) {
+            mapMasternodesByAddr.erase(it);
+            return;
+        }
+    }
+}
+
 void CMasternodeMan::AskForMN(CNode* pnode, const COutPoint& outpoint, CConnman& connman)
 {
     if(!pnode) return;
@@ -94,25 +134,26 @@ void CMasternodeMan::AskForMN(CNode* pnode, const COutPoint& outpoint, CConnman&
     LOCK(cs);
 
     CService addrSquashed = Params().AllowMultiplePorts() ? (CService)pnode->addr : CService(pnode->addr, 0);
-    auto it1 = mWeAskedForMasternodeListEntry.find(outpoint);
-    if (it1 != mWeAskedForMasternodeListEntry.end()) {
-        auto it2 = it1->second.find(addrSquashed);
-        if (it2 != it1->second.end()) {
-            if (GetTime() < it2->second) {
-                // we've asked recently, should not repeat too often or we could get banned
-                return;
-            }
-            // we asked this node for this outpoint but it's ok to ask again already
-            LogPrintf("CMasternodeMan::AskForMN -- Asking same peer %s for missing masternode entry again: %s\n", addrSquashed.ToString(), outpoint.ToStringShort());
-        } else {
-            // we already asked for this outpoint but not this node
-            LogPrintf("CMasternodeMan::AskForMN -- Asking new peer %s for missing masternode entry: %s\n", addrSquashed.ToString(), outpoint.ToStringShort());
+    std::pair<COutPoint, CService> request = std::make_pair(outpoint, addrSquashed);
+    int64_t nAskAgainTime = mWeAskedForMasternodeListEntry.GetExpireTime(request);
+    if (nAskAgainTime != 0) {
+        if (GetTime() < nAskAgainTime) {
+            // we've asked recently, should not repeat too often or we could get banned
+            return;
         }
+        // we asked this node for this outpoint but it's ok to ask again already
+        LogPrintf("CMasternodeMan::AskForMN -- Asking same peer %s for missing masternode entry again: %s\n", addrSquashed.ToString(), outpoint.ToStringShort());
     } else {
-        // we never asked any node for this outpoint
-        LogPrintf("CMasternodeMan::AskForMN -- Asking peer %s for missing masternode entry for the first time: %s\n", addrSquashed.ToString(), outpoint.ToStringShort());
+        // we didn't ask this node for this outpoint recently
+        LogPrintf("CMasternodeMan::AskForMN -- Asking peer %s for missing masternode entry: %s\n", addrSquashed.ToString(), outpoint.ToStringShort());
+    }
+    if(mWeAskedForMasternodeListEntry.IsFull()) {
+        mWeAskedForMasternodeListEntry.RemoveExpired(GetTime());
+    }
+    if(!mWeAskedForMasternodeListEntry.Set(request, true, GetTime() + DSEG_UPDATE_SECONDS)) {
+        // asking without remembering it could get us banned
+        return;
     }
-    mWeAskedForMasternodeListEntry[outpoint][addrSquashed] = GetTime() + DSEG_UPDATE_SECONDS;
 
     if (pnode->GetSendVersion() == 70208) {
         connman.PushMessage(pnode, msgMaker.Make(NetMsgType::DSEG, CTxIn(outpoint)));
@@ -199,10 +240,14 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
 
                 // erase all of the broadcasts we've seen from this txin, ...
                 mapSeenMasternodeBroadcast.erase(hash);
-                mWeAskedForMasternodeListEntry.erase(it->first);
+                const COutPoint& outpoint = it->first;
+                mWeAskedForMasternodeListEntry.EraseFrom(std::make_pair(outpoint, CService()),
+                    [&outpoint](const std::pair<COutPoint, CService>& request) { return request.first == outpoint; });
 
                 // and finally remove it from the list
                 it->second.FlagGovernanceItemsAsDirty();
+                RemoveFromAddrIndex(it->second.addr, &it->second);
+                ReleaseId(it->second.nId);
                 mapMasternodes.erase(it++);
                 fMasternodesRemoved = true;
             } else {
@@ -223,7 +268,7 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
                     // ask first MNB_RECOVERY_QUORUM_TOTAL masternodes we can connect to and we haven't asked recently
                     for(int i = 0; setRequested.size() < MNB_RECOVERY_QUORUM_TOTAL && i < (int)vecMasternodeRanks.size(); i++) {
                         // avoid banning
-                        if(mWeAskedForMasternodeListEntry.count(it->first) && mWeAskedForMasternodeListEntry[it->first].count(vecMasternodeRanks[i].second.addr)) continue;
+                        if(mWeAskedForMasternodeListEntry.HasKey(std::make_pair(it->first, vecMasternodeRanks[i].second.addr))) continue;
                         // didn't ask recently, ok to ask now
                         CService addr = vecMasternodeRanks[i].second.addr;
                         setRequested.insert(addr);
@@ -277,43 +322,10 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
             }
         }
 
-        // check who's asked for the Masternode list
-        auto it1 = mAskedUsForMasternodeList.begin();
-        while(it1 != mAskedUsForMasternodeList.end()){
-            if((*it1).second < GetTime()) {
-                mAskedUsForMasternodeList.erase(it1++);
-            } else {
-                ++it1;
-            }
-        }
-
-        // check who we asked for the Masternode list
-        it1 = mWeAskedForMasternodeList.begin();
-        while(it1 != mWeAskedForMasternodeList.end()){
-            if((*it1).second < GetTime()){
-                mWeAskedForMasternodeList.erase(it1++);
-            } else {
-                ++it1;
-            }
-        }
-
-        // check which Masternodes we've asked for
-        auto it2 = mWeAskedForMasternodeListEntry.begin();
-        while(it2 != mWeAskedForMasternodeListEntry.end()){
-            auto it3 = it2->second.begin();
-            while(it3 != it2->second.end()){
-                if(it3->second < GetTime()){
-                    it2->second.erase(it3++);
-                } else {
-                    ++it3;
-                }
-            }
-            if(it2->second.empty()) {
-                mWeAskedForMasternodeListEntry.erase(it2++);
-            } else {
-                ++it2;
-            }
-        }
+        // check who's asked for the Masternode list, who we asked for it and which Masternodes we've asked for
+        mAskedUsForMasternodeList.RemoveExpired(GetTime());
+        mWeAskedForMasternodeList.RemoveExpired(GetTime());
+        mWeAskedForMasternodeListEntry.RemoveExpired(GetTime());
 
         auto it3 = mWeAskedForVerification.begin();
         while(it3 != mWeAskedForVerification.end()){
@@ -327,15 +339,8 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
         // NOTE: do not expire mapSeenMasternodeBroadcast entries here, clean them on mnb updates!
 
         // remove expired mapSeenMasternodePing
-        std::map<uint256, CMasternodePing>::iterator it4 = mapSeenMasternodePing.begin();
-        while(it4 != mapSeenMasternodePing.end()){
-            if((*it4).second.IsExpired()) {
-                LogPrint("masternode", "CMasternodeMan::CheckAndRemove -- Removing expired Masternode ping: hash=%s\n", (*it4).second.GetHash().ToString());
-                mapSeenMasternodePing.erase(it4++);
-            } else {
-                ++it4;
-            }
-        }
+        int nPingsRemoved = mapSeenMasternodePing.RemoveExpired(GetAdjustedTime());
+        LogPrint("masternode", "CMasternodeMan::CheckAndRemove -- Removed %d expired Masternode pings\n", nPingsRemoved);
 
         // remove expired mapSeenMasternodeVerification
         std::map<uint256, CMasternodeVerification>::iterator itv2 = mapSeenMasternodeVerification.begin();
@@ -360,11 +365,14 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     mapMasternodes.clear();
-    mAskedUsForMasternodeList.clear();
-    mWeAskedForMasternodeList.clear();
-    mWeAskedForMasternodeListEntry.clear();
+    mapMasternodesByAddr.clear();
+    vecFreeIds.clear();
+    nNextId = 0;
+    mAskedUsForMasternodeList.Clear();
+    mWeAskedForMasternodeList.Clear();
+    mWeAskedForMasternodeListEntry.Clear();
     mapSeenMasternodeBroadcast.clear();
-    mapSeenMasternodePing.clear();
+    mapSeenMasternodePing.Clear();
     nDsqCount = 0;
     nLastSentinelPingTime = 0;
 }
@@ -422,21 +430,27 @@ void CMasternodeMan::DsegUpdate(CNode* pnode, CConnman& connman)
     CService addrSquashed = Params().AllowMultiplePorts() ? (CService)pnode->addr : CService(pnode->addr, 0);
     if(Params().NetworkIDString() == CBaseChainParams::MAIN) {
         if(!(pnode->addr.IsRFC1918() || pnode->addr.IsLocal())) {
-            auto it = mWeAskedForMasternodeList.find(addrSquashed);
-            if(it != mWeAskedForMasternodeList.end() && GetTime() < (*it).second) {
+            if(GetTime() < mWeAskedForMasternodeList.GetExpireTime(addrSquashed)) {
                 LogPrintf("CMasternodeMan::DsegUpdate -- we already asked %s for the list; skipping...\n", addrSquashed.ToString());
                 return;
             }
         }
     }
 
+    if(mWeAskedForMasternodeList.IsFull()) {
+        mWeAskedForMasternodeList.RemoveExpired(GetTime());
+    }
+    int64_t askAgain = GetTime() + DSEG_UPDATE_SECONDS;
+    if(!mWeAskedForMasternodeList.Set(addrSquashed, true, askAgain)) {
+        // asking without remembering it could get us banned
+        return;
+    }
+
     if (pnode->GetSendVersion() == 70208) {
         connman.PushMessage(pnode, msgMaker.Make(NetMsgType::DSEG, CTxIn()));
     } else {
         connman.PushMessage(pnode, msgMaker.Make(NetMsgType::DSEG, COutPoint()));
     }
-    int64_t askAgain = GetTime() + DSEG_UPDATE_SECONDS;
-    mWeAskedForMasternodeList[addrSquashed] = askAgain;
 
     LogPrint("masternode", "CMasternodeMan::DsegUpdate -- asked %s for the list\n", pnode->addr.ToString());
 }
@@ -845,8 +859,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
         // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
         LOCK2(cs_main, cs);
 
-        if(mapSeenMasternodePing.count(nHash)) return; //seen
-        mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
+        if(mapSeenMasternodePing.HasKey(nHash)) return; //seen
 
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s new\n", mnp.masternodeOutpoint.ToStringShort());
 
@@ -860,7 +873,11 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
         if(pmn && pmn->IsNewStartRequired()) return;
 
         int nDos = 0;
-        if(mnp.CheckAndUpdate(pmn, false, nDos, connman)) return;
+        if(mnp.CheckAndUpdate(pmn, false, nDos, connman)) {
+            // only accepted pings are remembered, made up ones can't take their room
+            AddSeenPing(mnp);
+            return;
+        }
 
         if(nDos > 0) {
             // if anything significant failed, mark that node
@@ -953,14 +970,20 @@ void CMasternodeMan::SyncAll(CNode* pnode, CConnman& connman)
     // should only ask for this once
     if(!isLocal && Params().NetworkIDString() == CBaseChainParams::MAIN) {
         LOCK2(cs_main, cs);
-        auto it = mAskedUsForMasternodeList.find(addrSquashed);
-        if (it != mAskedUsForMasternodeList.end() && it->second > GetTime()) {
+        if (mAskedUsForMasternodeList.GetExpireTime(addrSquashed) > GetTime()) {
             Misbehaving(pnode->GetId(), 34);
             LogPrintf("CMasternodeMan::%s -- peer already asked me for the list, peer=%d\n", __func__, pnode->id);
             return;
         }
+        if(mAskedUsForMasternodeList.IsFull()) {
+            mAskedUsForMasternodeList.RemoveExpired(GetTime());
+        }
         int64_t askAgain = GetTime() + DSEG_UPDATE_SECONDS;
-        mAskedUsForMasternodeList[addrSquashed] = askAgain;
+        if(!mAskedUsForMasternodeList.Set(addrSquashed, true, askAgain)) {
+            // can't remember the request, so don't serve it either
+            LogPrintf("CMasternodeMan::%s -- too many list requests, ignoring peer=%d\n", __func__, pnode->id);
+            return;
+        }
     }
 
     int nInvCount = 0;
@@ -990,7 +1013,7 @@ void CMasternodeMan::PushDsegInvs(CNode* pnode, const CMasternode& mn)
     pnode->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hashMNB));
     pnode->PushInventory(CInv(MSG_MASTERNODE_PING, hashMNP));
     mapSeenMasternodeBroadcast.insert(std::make_pair(hashMNB, std::make_pair(GetTime(), mnb)));
-    mapSeenMasternodePing.insert(std::make_pair(hashMNP, mnp));
+    AddSeenPing(mnp);
 }
 
 // Verification of masternodes via unique direct requests.
@@ -1035,13 +1058,6 @@ void CMasternodeMan::DoFullVerificationStep(CConnman& connman)
     int nOffset = MAX_POSE_RANK + nMyRank - 1;
     if(nOffset >= (int)vecMasternodeRanks.size()) return;
 
-    std::vector<const CMasternode*> vSortedByAddr;
-    for (const auto& mnpair : mapMasternodes) {
-        vSortedByAddr.push_back(&mnpair.second);
-    }
-
-    sort(vSortedByAddr.begin(), vSortedByAddr.end(), CompareByAddr());
-
     it = vecMasternodeRanks.begin() + nOffset;
     while(it != vecMasternodeRanks.end()) {
         if(it->second.IsPoSeVerified() || it->second.IsPoSeBanned()) {
@@ -1057,7 +1073,7 @@ void CMasternodeMan::DoFullVerificationStep(CConnman& connman)
         }
         LogPrint("masternode", "CMasternodeMan::DoFullVerificationStep -- Verifying masternode %s rank %d/%d address %s\n",
                     it->second.outpoint.ToStringShort(), it->first, nRanksTotal, it->second.addr.ToString());
-        if(SendVerifyRequest(CAddress(it->second.addr, NODE_NETWORK), vSortedByAddr, connman)) {
+        if(SendVerifyRequest(CAddress(it->second.addr, NODE_NETWORK), connman)) {
             nCount++;
             if(nCount >= MAX_POSE_CONNECTIONS) break;
         }
@@ -1079,7 +1095,6 @@ void CMasternodeMan::CheckSameAddr()
     if(!masternodeSync.IsSynced() || mapMasternodes.empty()) return;
 
     std::vector<CMasternode*> vBan;
-    std::vector<CMasternode*> vSortedByAddr;
 
     {
         LOCK(cs);
@@ -1087,13 +1102,8 @@ void CMasternodeMan::CheckSameAddr()
         CMasternode* pprevMasternode = NULL;
         CMasternode* pverifiedMasternode = NULL;
 
-        for (auto& mnpair : mapMasternodes) {
-            vSortedByAddr.push_back(&mnpair.second);
-        }
-
-        sort(vSortedByAddr.begin(), vSortedByAddr.end(), CompareByAddr());
-
-        for (const auto& pmn : vSortedByAddr) {
+        for (const auto& addrpair : mapMasternodesByAddr) {
+            CMasternode* pmn = addrpair.second;
             // check only (pre)enabled masternodes
             if(!pmn->IsEnabled() && !pmn->IsPreEnabled()) continue;
             // initial step
@@ -1127,7 +1137,7 @@ void CMasternodeMan::CheckSameAddr()
     }
 }
 
-bool CMasternodeMan::SendVerifyRequest(const CAddress& addr, const std::vector<const CMasternode*>& vSortedByAddr, CConnman& connman)
+bool CMasternodeMan::SendVerifyRequest(const CAddress& addr, CConnman& connman)
 {
     if(netfulfilledman.HasFulfilledRequest(addr, strprintf("%s", NetMsgType::MNVERIFY)+"-request")) {
         // we already asked for verification, not a good idea to do this too often, skip it
@@ -1285,66 +1295,66 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
         uint256 hash1 = mnv.GetSignatureHash1(blockHash);
         std::string strMessage1 = strprintf("%s%d%s", pnode->addr.ToString(false), mnv.nonce, blockHash.ToString());
 
-        for (auto& mnpair : mapMasternodes) {
-            if(CAddress(mnpair.second.addr, NODE_NETWORK) == pnode->addr) {
-                bool fFound = false;
-                if (sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
-                    fFound = CHashSigner::VerifyHash(hash1, mnpair.second.pubKeyMasternode, mnv.vchSig1, strError);
-                    // we don't care about mnv with signature in old format
-                } else {
-                    fFound = CMessageSigner::VerifyMessage(mnpair.second.pubKeyMasternode, mnv.vchSig1, strMessage1, strError);
+        auto range = mapMasternodesByAddr.equal_range(pnode->addr);
+        for (auto it = range.first; it != range.second; ++it) {
+            CMasternode& mn = *it->second;
+            bool fFound = false;
+            if (sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
+                fFound = CHashSigner::VerifyHash(hash1, mn.pubKeyMasternode, mnv.vchSig1, strError);
+                // we don't care about mnv with signature in old format
+            } else {
+                fFound = CMessageSigner::VerifyMessage(mn.pubKeyMasternode, mnv.vchSig1, strMessage1, strError);
+            }
+            if (fFound) {
+                // found it!
+                prealMasternode = &mn;
+                if(!mn.IsPoSeVerified()) {
+                    mn.DecreasePoSeBanScore();
                 }
-                if (fFound) {
-                    // found it!
-                    prealMasternode = &mnpair.second;
-                    if(!mnpair.second.IsPoSeVerified()) {
-                        mnpair.second.DecreasePoSeBanScore();
-                    }
-                    netfulfilledman.AddFulfilledRequest(pnode->addr, strprintf("%s", NetMsgType::MNVERIFY)+"-done");
-
-                    // we can only broadcast it if we are an activated masternode
-                    if(activeMasternode.outpoint.IsNull()) continue;
-                    // update ...
-                    mnv.addr = mnpair.second.addr;
-                    mnv.masternodeOutpoint1 = mnpair.second.outpoint;
-                    mnv.masternodeOutpoint2 = activeMasternode.outpoint;
-                    // ... and sign it
-                    std::string strError;
-
-                    if (sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
-                        uint256 hash2 = mnv.GetSignatureHash2(blockHash);
-
-                        if(!CHashSigner::SignHash(hash2, activeMasternode.keyMasternode, mnv.vchSig2)) {
-                            LogPrintf("MasternodeMan::ProcessVerifyReply -- SignHash() failed\n");
-                            return;
-                        }
+                netfulfilledman.AddFulfilledRequest(pnode->addr, strprintf("%s", NetMsgType::MNVERIFY)+"-done");
 
-                        if(!CHashSigner::VerifyHash(hash2, activeMasternode.pubKeyMasternode, mnv.vchSig2, strError)) {
-                            LogPrintf("MasternodeMan::ProcessVerifyReply -- VerifyHash() failed, error: %s\n", strError);
-                            return;
-                        }
-                    } else {
-                        std::string strMessage2 = strprintf("%s%d%s%s%s", mnv.addr.ToString(false), mnv.nonce, blockHash.ToString(),
-                                                mnv.masternodeOutpoint1.ToStringShort(), mnv.masternodeOutpoint2.ToStringShort());
+                // we can only broadcast it if we are an activated masternode
+                if(activeMasternode.outpoint.IsNull()) continue;
+                // update ...
+                mnv.addr = mn.addr;
+                mnv.masternodeOutpoint1 = mn.outpoint;
+                mnv.masternodeOutpoint2 = activeMasternode.outpoint;
+                // ... and sign it
+                std::string strError;
 
-                        if(!CMessageSigner::SignMessage(strMessage2, mnv.vchSig2, activeMasternode.keyMasternode)) {
-                            LogPrintf("MasternodeMan::ProcessVerifyReply -- SignMessage() failed\n");
-                            return;
-                        }
+                if (sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
+                    uint256 hash2 = mnv.GetSignatureHash2(blockHash);
 
-                        if(!CMessageSigner::VerifyMessage(activeMasternode.pubKeyMasternode, mnv.vchSig2, strMessage2, strError)) {
-                            LogPrintf("MasternodeMan::ProcessVerifyReply -- VerifyMessage() failed, error: %s\n", strError);
-                            return;
-                        }
+                    if(!CHashSigner::SignHash(hash2, activeMasternode.keyMasternode, mnv.vchSig2)) {
+                        LogPrintf("MasternodeMan::ProcessVerifyReply -- SignHash() failed\n");
+                        return;
                     }
 
-                    mWeAskedForVerification[pnode->addr] = mnv;
-                    mapSeenMasternodeVerification.insert(std::make_pair(mnv.GetHash(), mnv));
-                    mnv.Relay();
-
+                    if(!CHashSigner::VerifyHash(hash2, activeMasternode.pubKeyMasternode, mnv.vchSig2, strError)) {
+                        LogPrintf("MasternodeMan::ProcessVerifyReply -- VerifyHash() failed, error: %s\n", strError);
+                        return;
+                    }
                 } else {
-                    vpMasternodesToBan.push_back(&mnpair.second);
+                    std::string strMessage2 = strprintf("%s%d%s%s%s", mnv.addr.ToString(false), mnv.nonce, blockHash.ToString(),
+                                            mnv.masternodeOutpoint1.ToStringShort(), mnv.masternodeOutpoint2.ToStringShort());
+
+                    if(!CMessageSigner::SignMessage(strMessage2, mnv.vchSig2, activeMasternode.keyMasternode)) {
+                        LogPrintf("MasternodeMan::ProcessVerifyReply -- SignMessage() failed\n");
+                        return;
+                    }
+
+                    if(!CMessageSigner::VerifyMessage(activeMasternode.pubKeyMasternode, mnv.vchSig2, strMessage2, strError)) {
+                        LogPrintf("MasternodeMan::ProcessVerifyReply -- VerifyMessage() failed, error: %s\n", strError);
+                        return;
+                    }
                 }
+
+                mWeAskedForVerification[pnode->addr] = mnv;
+                mapSeenMasternodeVerification.insert(std::make_pair(mnv.GetHash(), mnv));
+                mnv.Relay();
+
+            } else {
+                vpMasternodesToBan.push_back(&mn);
             }
         }
         // no real masternode found?...
@@ -1495,9 +1505,9 @@ std::string CMasternodeMan::ToString() const
     std::ostringstream info;
 
     info << "Masternodes: " << (int)mapMasternodes.size() <<
-            ", peers who asked us for Masternode list: " << (int)mAskedUsForMasternodeList.size() <<
-            ", peers we asked for Masternode list: " << (int)mWeAskedForMasternodeList.size() <<
-            ", entries in Masternode list we asked for: " << (int)mWeAskedForMasternodeListEntry.size() <<
+            ", peers who asked us for Masternode list: " << (int)mAskedUsForMasternodeList.GetSize() <<
+            ", peers we asked for Masternode list: " << (int)mWeAskedForMasternodeList.GetSize() <<
+            ", entries in Masternode list we asked for: " << (int)mWeAskedForMasternodeListEntry.GetSize() <<
             ", nDsqCount: " << (int)nDsqCount;
 
     return info.str();
@@ -1505,6 +1515,19 @@ std::string CMasternodeMan::ToString() const
 
 bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBroadcast mnb, int& nDos, CConnman& connman)
 {
+    // Verify the signatures of a broadcast we are going to process before taking cs_main,
+    // so that list sync doesn't hold it for them. The ping is only checked on updates.
+    bool fProcess;
+    bool fUpdate;
+    {
+        LOCK(cs);
+        fProcess = !mapSeenMasternodeBroadcast.count(mnb.GetHash()) || mnb.fRecovery;
+        fUpdate = mapMasternodes.count(mnb.outpoint);
+    }
+    if(fProcess) {
+        mnb.VerifySignatures(fUpdate);
+    }
+
     // Need to lock cs_main here to ensure consistent locking order because the SimpleCheck call below locks cs_main
     LOCK(cs_main);
 
@@ -1558,7 +1581,13 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
         CMasternode* pmn = Find(mnb.outpoint);
         if(pmn) {
             CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-            if(!mnb.Update(pmn, nDos, connman)) {
+            CService addrOld = pmn->addr;
+            bool fUpdated = mnb.Update(pmn, nDos, connman);
+            if(!(pmn->addr == addrOld)) {
+                RemoveFromAddrIndex(addrOld, pmn);
+                AddToAddrIndex(pmn);
+            }
+            if(!fUpdated) {
                 LogPrint("masternode", "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.outpoint.ToStringShort());
                 return false;
             }
@@ -1623,6 +1652,23 @@ void CMasternodeMan::UpdateLastSentinelPingTime()
     nLastSentinelPingTime = GetTime();
 }
 
+void CMasternodeMan::SetMaxSeenPings(unsigned int nMaxSeenPings)
+{
+    LOCK(cs);
+    mapSeenMasternodePing.SetMaxSize(nMaxSeenPings);
+}
+
+void CMasternodeMan::AddSeenPing(const CMasternodePing& mnp)
+{
+    LOCK(cs);
+    if(mapSeenMasternodePing.IsFull()) {
+        mapSeenMasternodePing.RemoveExpired(GetAdjustedTime());
+    }
+    if(!mapSeenMasternodePing.Set(mnp.GetHash(), mnp, mnp.GetExpireTime())) {
+        LogPrint("masternode", "CMasternodeMan::AddSeenPing -- too many pings seen, not remembering ping for masternode=%s\n", mnp.masternodeOutpoint.ToStringShort());
+    }
+}
+
 bool CMasternodeMan::IsSentinelPingActive()
 {
     LOCK(cs);
@@ -1678,7 +1724,7 @@ void CMasternodeMan::SetMasternodeLastPing(const COutPoint& outpoint, const CMas
     if(mnp.fSentinelIsCurrent) {
         UpdateLastSentinelPingTime();
     }
-    mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
+    AddSeenPing(mnp);
 
     CMasternodeBroadcast mnb(*pmn);
     uint256 hash = mnb.GetHash();
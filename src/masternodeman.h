@@ -5,6 +5,7 @@
 #ifndef MASTERNODEMAN_H
 #define MASTERNODEMAN_H
 
+#include "expiringmap.h"
 #include "masternode.h"
 #include "sync.h"
 
@@ -13,6 +14,9 @@ class CConnman;
 
 extern CMasternodeMan mnodeman;
 
+/** Default for -maxseenpings, the number of unexpired masternode pings remembered */
+static const unsigned int DEFAULT_MAX_SEEN_PINGS = 50000;
+
 class CMasternodeMan
 {
 public:
@@ -39,6 +43,10 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    // Don't track more than this many list requests and list entry requests
+    static const int MAX_LIST_REQUESTS          = 10000;
+    static const int MAX_LIST_ENTRY_REQUESTS    = 50000;
+
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -48,12 +56,20 @@ private:
 
     // map to hold all MNs
     std::map<COutPoint, CMasternode> mapMasternodes;
-    // who's asked for the Masternode list and the last time
-    std::map<CService, int64_t> mAskedUsForMasternodeList;
-    // who we asked for the Masternode list and the last time
-    std::map<CService, int64_t> mWeAskedForMasternodeList;
-    // which Masternodes we've asked for
-    std::map<COutPoint, std::map<CService, int64_t> > mWeAskedForMasternodeListEntry;
+    // ids of removed MNs, handed out again before new ones so that ids stay dense
+    // and other managers can keep per masternode data in vectors indexed by id
+    std::vector<uint32_t> vecFreeIds;
+    uint32_t nNextId;
+    // serial of the last id handed out, not reset with the ids
+    uint32_t nLastIdSerial;
+    // all MNs by address, kept in step with mapMasternodes and the addresses of its entries
+    std::multimap<CService, CMasternode*> mapMasternodesByAddr;
+    // who's asked for the Masternode list and until when they shouldn't ask again
+    ExpiringMap<CService, bool> mAskedUsForMasternodeList;
+    // who we asked for the Masternode list and until when we shouldn't ask again
+    ExpiringMap<CService, bool> mWeAskedForMasternodeList;
+    // which Masternodes we've asked which peers for
+    ExpiringMap<std::pair<COutPoint, CService>, bool> mWeAskedForMasternodeListEntry;
 
     // who we asked for the masternode verification
     std::map<CService, CMasternodeVerification> mWeAskedForVerification;
@@ -80,6 +96,16 @@ private:
     /// Find an entry
     CMasternode* Find(const COutPoint& outpoint);
 
+    /// Give a masternode added to mapMasternodes a free id and a new serial
+    void AssignId(CMasternode& mn);
+    /// Make the id of a masternode removed from mapMasternodes free again
+    void ReleaseId(uint32_t nId);
+
+    /// Index a masternode of mapMasternodes under its current address
+    void AddToAddrIndex(CMasternode* pmn);
+    /// Drop a masternode from the address index, addr being the address it was indexed under
+    void RemoveFromAddrIndex(const CService& addr, const CMasternode* pmn);
+
     bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
 
     void SyncSingle(CNode* pnode, const COutPoint& outpoint, CConnman& connman);
@@ -90,8 +116,8 @@ private:
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
-    // Keep track of all pings I've seen
-    std::map<uint256, CMasternodePing> mapSeenMasternodePing;
+    // Keep track of all pings I've accepted, until they expire
+    ExpiringMap<uint256, CMasternodePing> mapSeenMasternodePing;
     // Keep track of all verifications I've seen
     std::map<uint256, CMasternodeVerification> mapSeenMasternodeVerification;
     // keep track of dsq count to prevent masternodes from gaming darksend queue
@@ -113,6 +139,15 @@ public:
         }
 
         READWRITE(mapMasternodes);
+        if(ser_action.ForRead()) {
+            mapMasternodesByAddr.clear();
+            vecFreeIds.clear();
+            nNextId = 0;
+            for (auto& mnpair : mapMasternodes) {
+                AssignId(mnpair.second);
+                AddToAddrIndex(&mnpair.second);
+            }
+        }
         READWRITE(mAskedUsForMasternodeList);
         READWRITE(mWeAskedForMasternodeList);
         READWRITE(mWeAskedForMasternodeListEntry);
@@ -193,7 +228,7 @@ public:
 
     void DoFullVerificationStep(CConnman& connman);
     void CheckSameAddr();
-    bool SendVerifyRequest(const CAddress& addr, const std::vector<const CMasternode*>& vSortedByAddr, CConnman& connman);
+    bool SendVerifyRequest(const CAddress& addr, CConnman& connman);
     void ProcessPendingMnvRequests(CConnman& connman);
     void SendVerifyReply(CNode* pnode, CMasternodeVerification& mnv, CConnman& connman);
     void ProcessVerifyReply(CNode* pnode, CMasternodeVerification& mnv);
@@ -226,6 +261,10 @@ public:
 
     bool IsSentinelPingActive();
     void UpdateLastSentinelPingTime();
+
+    void SetMaxSeenPings(unsigned int nMaxSeenPings);
+    /// Remember an accepted ping, dropping expired ones if there is no room left
+    void AddSeenPing(const CMasternodePing& mnp);
     bool AddGovernanceVote(const COutPoint& outpoint, uint256 nGovernanceObjectHash);
     void RemoveGovernanceObject(uint256 nGovernanceObjectHash);
 
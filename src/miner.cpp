@@ -30,6 +30,7 @@
 #include "blocksigner.h"
 
 #include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <queue>
@@ -62,6 +63,104 @@ public:
     }
 };
 
+CBlockTemplateCache blockTemplateCache;
+
+CBlockTemplateCache::CBlockTemplateCache() :
+    fConnected(false),
+    fValid(false),
+    nHeight(0),
+    nLockTimeCutoff(0),
+    nBlockMaxSize(0),
+    nLastPackageFees(0),
+    nLastPackageSize(0),
+    nTransactionsUpdated(0)
+{
+}
+
+void CBlockTemplateCache::TransactionAddedToMempool(CTransactionRef tx)
+{
+    LOCK(cs);
+    if (!fValid)
+        return;
+    if (vAdded.size() >= MAX_PENDING_ADDED) {
+        fValid = false;
+        vAdded.clear();
+        return;
+    }
+    vAdded.push_back(tx->GetHash());
+    ++nTransactionsUpdated;
+}
+
+void CBlockTemplateCache::TransactionRemovedFromMempool(CTransactionRef tx, MemPoolRemovalReason reason)
+{
+    LOCK(cs);
+    if (!fValid)
+        return;
+    if (setSelected.count(tx->GetHash())) {
+        // The selection isn't a valid block anymore
+        fValid = false;
+        vAdded.clear();
+        return;
+    }
+    ++nTransactionsUpdated;
+}
+
+bool CBlockTemplateCache::Get(const uint256& hashPrevBlockIn, int nHeightIn, int64_t nLockTimeCutoffIn, unsigned int nBlockMaxSizeIn, const CFeeRate& blockMinFeeRateIn,
+                              std::vector<uint256>& vSelectedRet, CAmount& nLastPackageFeesRet, uint64_t& nLastPackageSizeRet,
+                              std::vector<uint256>& vAddedRet)
+{
+    AssertLockHeld(mempool.cs);
+    LOCK(cs);
+    if (!fValid || hashPrevBlockIn != hashPrevBlock ||
+            nHeightIn != nHeight || nLockTimeCutoffIn != nLockTimeCutoff ||
+            nBlockMaxSizeIn != nBlockMaxSize || !(blockMinFeeRateIn == blockMinFeeRate))
+        return false;
+    // Something changed the mempool without a signal (prioritisetransaction,
+    // clear, ...), the selection may not be what we would pick anymore
+    if (mempool.GetTransactionsUpdated() != nTransactionsUpdated)
+        return false;
+
+    vSelectedRet = vSelected;
+    nLastPackageFeesRet = nLastPackageFees;
+    nLastPackageSizeRet = nLastPackageSize;
+    vAddedRet = vAdded;
+    return true;
+}
+
+void CBlockTemplateCache::Set(const uint256& hashPrevBlockIn, int nHeightIn, int64_t nLockTimeCutoffIn, unsigned int nBlockMaxSizeIn, const CFeeRate& blockMinFeeRateIn,
+                              const std::vector<uint256>& vSelectedIn, CAmount nLastPackageFeesIn, uint64_t nLastPackageSizeIn)
+{
+    AssertLockHeld(mempool.cs);
+    LOCK(cs);
+    if (!fConnected) {
+        mempool.NotifyEntryAdded.connect(boost::bind(&CBlockTemplateCache::TransactionAddedToMempool, this, _1));
+        mempool.NotifyEntryRemoved.connect(boost::bind(&CBlockTemplateCache::TransactionRemovedFromMempool, this, _1, _2));
+        fConnected = true;
+    }
+
+    hashPrevBlock = hashPrevBlockIn;
+    nHeight = nHeightIn;
+    nLockTimeCutoff = nLockTimeCutoffIn;
+    nBlockMaxSize = nBlockMaxSizeIn;
+    blockMinFeeRate = blockMinFeeRateIn;
+    vSelected = vSelectedIn;
+    setSelected = std::set<uint256>(vSelectedIn.begin(), vSelectedIn.end());
+    nLastPackageFees = nLastPackageFeesIn;
+    nLastPackageSize = nLastPackageSizeIn;
+    vAdded.clear();
+    nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    fValid = true;
+}
+
+void CBlockTemplateCache::Clear()
+{
+    LOCK(cs);
+    fValid = false;
+    vSelected.clear();
+    setSelected.clear();
+    vAdded.clear();
+}
+
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
 {
     int64_t nOldTime = pblock->nTime;
@@ -109,6 +208,9 @@ void BlockAssembler::resetBlock()
 
     lastFewTxs = 0;
     blockFinished = false;
+
+    nLastPackageFees = 0;
+    nLastPackageSize = 0;
 }
 
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(CWallet *wallet, const CChainParams& chainparams, const CScript& scriptPubKeyIn, bool fProofOfStake)
@@ -127,9 +229,50 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(CWallet *wallet,
     pblocktemplate->vTxFees.push_back(-1); // updated at end
     pblocktemplate->vTxSigOps.push_back(-1); // updated at end
 
+    // For proof-of-stake the kernel search comes first. It works on the tip
+    // as of now and must not hold cs_main or mempool.cs, which are only taken
+    // below to assemble the block around the coinstake found.
+    CMutableTransaction coinstakeTx;
+    CBlockIndex* pindexStake = nullptr;
+    static int64_t nLastCoinStakeSearchTime = GetAdjustedTime();
+    if(fProofOfStake)
+    {
+        assert(wallet);
+        boost::this_thread::interruption_point();
+        CAmount blockReward;
+        {
+            LOCK(cs_main);
+            pindexStake = chainActive.Tip();
+            assert(pindexStake != nullptr);
+            pblock->nTime = GetAdjustedTime();
+            pblock->nBits = GetNextWorkRequired(pindexStake, pblock, chainparams.GetConsensus());
+            blockReward = GetBlockSubsidy(pindexStake->nHeight, Params().GetConsensus());
+        }
+        int64_t nSearchTime = pblock->nTime; // search to current time
+        bool fStakeFound = false;
+        if (nSearchTime >= nLastCoinStakeSearchTime) {
+            unsigned int nTxNewTime = 0;
+            if (wallet->CreateCoinStake(pindexStake, pblock->nBits, blockReward,
+                                        coinstakeTx, nTxNewTime))
+            {
+                pblock->nTime = nTxNewTime;
+                fStakeFound = true;
+            }
+
+            nLastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
+            nLastCoinStakeSearchTime = nSearchTime;
+        }
+
+        if (!fStakeFound)
+            return nullptr;
+    }
+
     LOCK2(cs_main, mempool.cs);
     CBlockIndex* pindexPrev = chainActive.Tip();
     assert(pindexPrev != nullptr);
+    // A kernel only stakes on top of the block it was searched on
+    if (fProofOfStake && pindexPrev != pindexStake)
+        return nullptr;
     nHeight = pindexPrev->nHeight + 1;
 
     pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
@@ -138,7 +281,8 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(CWallet *wallet,
     if (chainparams.MineBlocksOnDemand())
         pblock->nVersion = GetArg("-blockversion", pblock->nVersion);
 
-    pblock->nTime = GetAdjustedTime();
+    if(!fProofOfStake)
+        pblock->nTime = GetAdjustedTime();
     const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
 
     nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
@@ -157,46 +301,49 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(CWallet *wallet,
     coinbaseTx.vout.resize(1);
     coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
     CAmount blockReward = nFees + GetBlockSubsidy(pindexPrev->nHeight, Params().GetConsensus());
-    std::vector<CWalletTx*> vwtxPrev;
-    static int64_t nLastCoinStakeSearchTime = GetAdjustedTime();
     if(fProofOfStake)
     {
-        assert(wallet);
-        boost::this_thread::interruption_point();
-        pblock->nBits = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
-        CMutableTransaction coinstakeTx;
-        int64_t nSearchTime = pblock->nTime; // search to current time
-        bool fStakeFound = false;
-        if (nSearchTime >= nLastCoinStakeSearchTime) {
-            unsigned int nTxNewTime = 0;
-            if (wallet->CreateCoinStake(pblock->nBits, blockReward,
-                                        coinstakeTx, nTxNewTime,
-                                        vwtxPrev))
-            {
-                pblock->nTime = nTxNewTime;
-                coinbaseTx.vout[0].SetEmpty();
-                pblock->vtx.emplace_back(MakeTransactionRef(coinstakeTx));
-                fStakeFound = true;
-            }
-
-            nLastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
-            nLastCoinStakeSearchTime = nSearchTime;
-        }
-
-        if (!fStakeFound)
-            return nullptr;
+        // Update coinstake transaction with additional info about masternode and governance payments,
+        // get some info back to pass to getblocktemplate
+        CTxOut txoutMasternode;
+        std::vector<CTxOut> voutSuperblock;
+        FillBlockPayments(coinstakeTx, nHeight, blockReward, txoutMasternode, voutSuperblock);
+        AdjustMasternodePayment(coinstakeTx, txoutMasternode);
+        LogPrintf("CreateNewBlock -- coinstake nBlockHeight %d blockReward %lld txoutMasternode %s txNew %s\n",
+                  nHeight, blockReward, txoutMasternode.ToString(), coinstakeTx.ToString());
+        coinbaseTx.vout[0].SetEmpty();
+        pblock->vtx.emplace_back(MakeTransactionRef(coinstakeTx));
     }
     else
     {
         coinbaseTx.vout[0].nValue = nFees + blockReward;
     }
 
-    addPriorityTxs();
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
+    int nCachedTxs = 0;
     {
         LOCK(mempool.cs);
-        addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+        const size_t nFirstTx = pblock->vtx.size();
+        const size_t nFirstTxFee = pblocktemplate->vTxFees.size();
+        if (!addCachedTxs(pindexPrev->GetBlockHash(), nCachedTxs)) {
+            // Start over from the whole mempool
+            resetBlock();
+            pblock->vtx.resize(nFirstTx);
+            pblocktemplate->vTxFees.resize(nFirstTxFee);
+            pblocktemplate->vTxSigOps.resize(nFirstTxFee);
+            nCachedTxs = 0;
+
+            addPriorityTxs();
+            addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+        }
+
+        std::vector<uint256> vSelected;
+        vSelected.reserve(pblock->vtx.size() - nFirstTx);
+        for (size_t i = nFirstTx; i < pblock->vtx.size(); ++i)
+            vSelected.push_back(pblock->vtx[i]->GetHash());
+        blockTemplateCache.Set(pindexPrev->GetBlockHash(), nHeight, nLockTimeCutoff, nBlockMaxSize, blockMinFeeRate,
+                               vSelected, nLastPackageFees, nLastPackageSize);
     }
     coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
     pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
@@ -212,7 +359,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(CWallet *wallet,
 
     int64_t nTime2 = GetTimeMicros();
 
-    LogPrint("bench", "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+    LogPrint("bench", "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants, %d txs from cache), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, nCachedTxs, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
 
     return std::move(pblocktemplate);
 }
@@ -512,12 +659,66 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         }
 
         ++nPackagesSelected;
+        nLastPackageFees = packageFees;
+        nLastPackageSize = packageSize;
 
         // Update transactions that depend on each of these
         nDescendantsUpdated += UpdatePackagesForAdded(ancestors, mapModifiedTx);
     }
 }
 
+bool BlockAssembler::addCachedTxs(const uint256& hashPrevBlock, int &nCachedTxs)
+{
+    std::vector<uint256> vSelected;
+    std::vector<uint256> vAdded;
+    if (!blockTemplateCache.Get(hashPrevBlock, nHeight, nLockTimeCutoff, nBlockMaxSize, blockMinFeeRate,
+                                vSelected, nLastPackageFees, nLastPackageSize, vAdded))
+        return false;
+
+    BOOST_FOREACH(const uint256& hash, vSelected) {
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end())
+            return false;
+        AddToBlock(it);
+        ++nCachedTxs;
+    }
+
+    // Transactions which entered the mempool since, best feerate first
+    std::vector<CTxMemPool::txiter> vNew;
+    BOOST_FOREACH(const uint256& hash, vAdded) {
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it != mempool.mapTx.end() && !inBlock.count(it))
+            vNew.push_back(it);
+    }
+    std::sort(vNew.begin(), vNew.end(), [](CTxMemPool::txiter a, CTxMemPool::txiter b) {
+        return CompareTxMemPoolEntryByScore()(*a, *b);
+    });
+
+    BOOST_FOREACH(CTxMemPool::txiter it, vNew) {
+        // With parents outside the block it may go in as part of a package
+        if (isStillDependent(it))
+            return false;
+        // Everything else pays less, and addPackageTxs would stop here too
+        if (it->GetModifiedFee() < blockMinFeeRate.GetFee(it->GetTxSize()))
+            break;
+        // Appending is only what addPackageTxs would do if the transaction
+        // doesn't beat the last package selected
+        if (nLastPackageSize > 0 &&
+                (double)it->GetModifiedFee() * nLastPackageSize >= (double)nLastPackageFees * it->GetTxSize())
+            return false;
+        // Out of room, let addPackageTxs pick the best that fits
+        if (!TestPackage(it->GetTxSize(), it->GetSigOpCount()))
+            return false;
+        if (!IsFinalTx(it->GetTx(), nHeight, nLockTimeCutoff))
+            continue;
+
+        AddToBlock(it);
+        nLastPackageFees = it->GetModifiedFee();
+        nLastPackageSize = it->GetTxSize();
+    }
+    return true;
+}
+
 void BlockAssembler::addPriorityTxs()
 {
     // How much of the block should be dedicated to high-priority transactions,
@@ -536,14 +737,18 @@ void BlockAssembler::addPriorityTxs()
     typedef std::map<CTxMemPool::txiter, double, CTxMemPool::CompareIteratorByHash>::iterator waitPriIter;
     double actualPriority = -1;
 
-    vecPriority.reserve(mempool.mapTx.size());
-    for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
-         mi != mempool.mapTx.end(); ++mi)
+    // The pass stops at the first transaction below the free threshold, so
+    // only those over it are worth looking at. The free_height index has them
+    // all at its start and the rest of the mempool is never touched.
+    CTxMemPool::indexed_transaction_set::index<free_height>::type::iterator mi = mempool.mapTx.get<free_height>().begin();
+    for (; mi != mempool.mapTx.get<free_height>().end() && mi->GetFreeHeight() <= (unsigned int)nHeight; ++mi)
     {
         double dPriority = mi->GetPriority(nHeight);
         CAmount dummy;
         mempool.ApplyDeltas(mi->GetTx().GetHash(), dPriority, dummy);
-        vecPriority.push_back(TxCoinAgePriority(dPriority, mi));
+        if (!AllowFree(dPriority))
+            continue;
+        vecPriority.push_back(TxCoinAgePriority(dPriority, mempool.mapTx.project<0>(mi)));
     }
     std::make_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
 
@@ -130,6 +130,64 @@ struct update_for_parent_inclusion
     CTxMemPool::txiter iter;
 };
 
+/**
+ * Transaction selection of the last block template. It follows the mempool
+ * signals so that the next template on the same tip only has to consider the
+ * transactions which entered the mempool since, rather than the whole mempool.
+ * Lock order: cs_main, mempool.cs, then the cache's own lock.
+ */
+class CBlockTemplateCache
+{
+private:
+    // Don't track more than this many mempool additions between templates
+    static const size_t MAX_PENDING_ADDED = 10000;
+
+    mutable CCriticalSection cs;
+    bool fConnected;
+    bool fValid;
+
+    // What the selection was made for
+    uint256 hashPrevBlock;
+    int nHeight;
+    int64_t nLockTimeCutoff;
+    unsigned int nBlockMaxSize;
+    CFeeRate blockMinFeeRate;
+
+    // The selection, in block order, and the feerate of its last package
+    std::vector<uint256> vSelected;
+    std::set<uint256> setSelected;
+    CAmount nLastPackageFees;
+    uint64_t nLastPackageSize;
+
+    // Transactions added to the mempool since the selection was made
+    std::vector<uint256> vAdded;
+    // Mempool update counter expected if the signals account for every change
+    unsigned int nTransactionsUpdated;
+
+    void TransactionAddedToMempool(CTransactionRef tx);
+    void TransactionRemovedFromMempool(CTransactionRef tx, MemPoolRemovalReason reason);
+
+public:
+    CBlockTemplateCache();
+
+    /**
+     * Return the selection made on top of hashPrevBlock with the same
+     * finality cutoffs and limits, and the transactions added to the mempool since, or false if it is
+     * gone stale and the block has to be assembled from scratch.
+     * Requires mempool.cs.
+     */
+    bool Get(const uint256& hashPrevBlockIn, int nHeightIn, int64_t nLockTimeCutoffIn, unsigned int nBlockMaxSizeIn, const CFeeRate& blockMinFeeRateIn,
+             std::vector<uint256>& vSelectedRet, CAmount& nLastPackageFeesRet, uint64_t& nLastPackageSizeRet,
+             std::vector<uint256>& vAddedRet);
+    /** Remember the selection of a template just assembled. Requires mempool.cs. */
+    void Set(const uint256& hashPrevBlockIn, int nHeightIn, int64_t nLockTimeCutoffIn, unsigned int nBlockMaxSizeIn, const CFeeRate& blockMinFeeRateIn,
+             const std::vector<uint256>& vSelectedIn, CAmount nLastPackageFeesIn, uint64_t nLastPackageSizeIn);
+    /** Forget the selection, so the next template is assembled from scratch */
+    void Clear();
+};
+
+extern CBlockTemplateCache blockTemplateCache;
+
 /** Generate a new block, without valid proof-of-work */
 class BlockAssembler
 {
@@ -159,9 +217,17 @@ private:
     int lastFewTxs;
     bool blockFinished;
 
+    // Feerate of the last package added by addPackageTxs
+    CAmount nLastPackageFees;
+    uint64_t nLastPackageSize;
+
 public:
     BlockAssembler(const CChainParams& chainparams);
-    /** Construct a new block template with coinbase to scriptPubKeyIn */
+    /**
+     * Construct a new block template with coinbase to scriptPubKeyIn. For
+     * proof-of-stake the coinstake kernel is searched in wallet before
+     * cs_main is taken, so callers must not hold cs_main then.
+     */
     std::unique_ptr<CBlockTemplate> CreateNewBlock(CWallet *wallet, const CChainParams& chainparams, const CScript& scriptPubKeyIn, bool fProofOfStake);
 
 private:
@@ -178,6 +244,11 @@ private:
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
       * statistics from the package selection (for logging statistics). */
     void addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated);
+    /** Add the transactions of the cached template selection, followed by the
+      * ones which entered the mempool since and would come last in a rebuilt
+      * block anyway. Returns false if the block has to be assembled from
+      * scratch, leaving partial state behind. */
+    bool addCachedTxs(const uint256& hashPrevBlock, int &nCachedTxs);
 
     // helper function for addPriorityTxs
     /** Test if tx will still "fit" in the block */
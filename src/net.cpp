@@ -637,6 +637,18 @@ void CNode::SetAddrLocal(const CService& addrLocalIn) {
 
 #undef X
 #define X(name) stats.name = name
+std::string CNode::AccountForProcessedMsg(const std::string& strCommand, unsigned int nBytes, int64_t nMicros, bool fFailed)
+{
+    LOCK(cs_processStats);
+    // as with mapRecvBytesPerMsgCmd, only allow valid commands
+    mapMsgCmdProcessStats::iterator i = mapProcessStatsPerMsgCmd.find(strCommand);
+    if (i == mapProcessStatsPerMsgCmd.end())
+        i = mapProcessStatsPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+    assert(i != mapProcessStatsPerMsgCmd.end());
+    i->second.Add(nBytes, nMicros, fFailed);
+    return i->first;
+}
+
 void CNode::copyStats(CNodeStats &stats)
 {
     stats.nodeid = this->GetId();
@@ -669,6 +681,10 @@ void CNode::copyStats(CNodeStats &stats)
         X(mapRecvBytesPerMsgCmd);
         X(nRecvBytes);
     }
+    {
+        LOCK(cs_processStats);
+        X(mapProcessStatsPerMsgCmd);
+    }
     X(fWhitelisted);
 
     // It is common for nodes with good ping times to suddenly become lagged,
@@ -2827,9 +2843,12 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     fPauseSend = false;
     nProcessQueueSize = 0;
 
-    BOOST_FOREACH(const std::string &msg, getAllNetMessageTypes())
+    BOOST_FOREACH(const std::string &msg, getAllNetMessageTypes()) {
         mapRecvBytesPerMsgCmd[msg] = 0;
+        mapProcessStatsPerMsgCmd[msg] = CMsgProcessStats();
+    }
     mapRecvBytesPerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = 0;
+    mapProcessStatsPerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = CMsgProcessStats();
 
     if (fLogIPs)
         LogPrint("net", "Added connection to %s peer=%d\n", addrName, id);
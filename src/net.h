@@ -596,6 +596,29 @@ extern CCriticalSection cs_mapLocalHost;
 extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 typedef std::map<std::string, uint64_t> mapMsgCmdSize; //command, total bytes
 
+/** What ProcessMessage spent on the messages of one command */
+struct CMsgProcessStats
+{
+    uint64_t nCount;
+    uint64_t nBytes;
+    uint64_t nFailed;
+    int64_t nTotalMicros;
+    int64_t nMaxMicros;
+
+    CMsgProcessStats() : nCount(0), nBytes(0), nFailed(0), nTotalMicros(0), nMaxMicros(0) {}
+
+    void Add(unsigned int nBytesIn, int64_t nMicros, bool fFailed)
+    {
+        nCount++;
+        nBytes += nBytesIn;
+        if (fFailed)
+            nFailed++;
+        nTotalMicros += nMicros;
+        nMaxMicros = std::max(nMaxMicros, nMicros);
+    }
+};
+typedef std::map<std::string, CMsgProcessStats> mapMsgCmdProcessStats; //command, processing stats
+
 class CNodeStats
 {
 public:
@@ -617,6 +640,7 @@ public:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdProcessStats mapProcessStatsPerMsgCmd;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
@@ -745,6 +769,8 @@ protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    CCriticalSection cs_processStats;
+    mapMsgCmdProcessStats mapProcessStatsPerMsgCmd;
 
 public:
     uint256 hashContinue;
@@ -926,6 +952,12 @@ public:
 
     void copyStats(CNodeStats &stats);
 
+    /**
+     * Account for the processing of a message of strCommand, and return the
+     * command it was accounted to: NET_MESSAGE_COMMAND_OTHER if it is unknown.
+     */
+    std::string AccountForProcessedMsg(const std::string& strCommand, unsigned int nBytes, int64_t nMicros, bool fFailed);
+
     ServiceFlags GetLocalServices() const
     {
         return nLocalServices;
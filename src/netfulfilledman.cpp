@@ -8,68 +8,56 @@
 
 CNetFulfilledRequestManager netfulfilledman;
 
-void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, const std::string& strRequest)
+bool CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
     LOCK(cs_mapFulfilledRequests);
     CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    mapFulfilledRequests[addrSquashed][strRequest] = GetTime() + Params().FulfilledRequestExpireTime();
+    // unexpired requests are never dropped for new ones, they rate limit their peers
+    if(mapFulfilledRequests.IsFull()) {
+        mapFulfilledRequests.RemoveExpired(GetTime());
+    }
+    if(!mapFulfilledRequests.Set(std::make_pair(addrSquashed, strRequest), true, GetTime() + Params().FulfilledRequestExpireTime())) {
+        LogPrintf("CNetFulfilledRequestManager::AddFulfilledRequest -- too many fulfilled requests, not remembering %s for %s\n", strRequest, addrSquashed.ToString());
+        return false;
+    }
+    return true;
 }
 
 bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
     LOCK(cs_mapFulfilledRequests);
     CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
-
-    return  it != mapFulfilledRequests.end() &&
-            it->second.find(strRequest) != it->second.end() &&
-            it->second[strRequest] > GetTime();
+    return mapFulfilledRequests.GetExpireTime(std::make_pair(addrSquashed, strRequest)) > GetTime();
 }
 
 void CNetFulfilledRequestManager::RemoveFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
     LOCK(cs_mapFulfilledRequests);
     CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
-
-    if (it != mapFulfilledRequests.end()) {
-        it->second.erase(strRequest);
-    }
+    mapFulfilledRequests.Erase(std::make_pair(addrSquashed, strRequest));
 }
 
 void CNetFulfilledRequestManager::CheckAndRemove()
 {
     LOCK(cs_mapFulfilledRequests);
-
-    int64_t now = GetTime();
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.begin();
-
-    while(it != mapFulfilledRequests.end()) {
-        fulfilledreqmapentry_t::iterator it_entry = it->second.begin();
-        while(it_entry != it->second.end()) {
-            if(now > it_entry->second) {
-                it->second.erase(it_entry++);
-            } else {
-                ++it_entry;
-            }
-        }
-        if(it->second.size() == 0) {
-            mapFulfilledRequests.erase(it++);
-        } else {
-            ++it;
-        }
-    }
+    mapFulfilledRequests.RemoveExpired(GetTime());
 }
 
 void CNetFulfilledRequestManager::Clear()
 {
     LOCK(cs_mapFulfilledRequests);
-    mapFulfilledRequests.clear();
+    mapFulfilledRequests.Clear();
+}
+
+void CNetFulfilledRequestManager::SetMaxSize(unsigned int nMaxSize)
+{
+    LOCK(cs_mapFulfilledRequests);
+    mapFulfilledRequests.SetMaxSize(nMaxSize);
 }
 
 std::string CNetFulfilledRequestManager::ToString() const
 {
     std::ostringstream info;
-    info << "Nodes with fulfilled requests: " << (int)mapFulfilledRequests.size();
+    info << "Fulfilled requests: " << (int)mapFulfilledRequests.GetSize();
     return info.str();
 }
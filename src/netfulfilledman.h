@@ -5,6 +5,7 @@
 #ifndef NETFULFILLEDMAN_H
 #define NETFULFILLEDMAN_H
 
+#include "expiringmap.h"
 #include "netaddress.h"
 #include "serialize.h"
 #include "sync.h"
@@ -12,37 +13,58 @@
 class CNetFulfilledRequestManager;
 extern CNetFulfilledRequestManager netfulfilledman;
 
+/** Default for -maxfulfilledrequests, the number of unexpired fulfilled requests remembered */
+static const unsigned int DEFAULT_MAX_FULFILLED_REQUESTS = 100000;
+
 // Fulfilled requests are used to prevent nodes from asking for the same data on sync
 // and from being banned for doing so too often.
 class CNetFulfilledRequestManager
 {
 private:
-    typedef std::map<std::string, int64_t> fulfilledreqmapentry_t;
-    typedef std::map<CService, fulfilledreqmapentry_t> fulfilledreqmap_t;
+    typedef std::pair<CService, std::string> fulfilledreq_t;
+    typedef ExpiringMap<fulfilledreq_t, bool> fulfilledreqmap_t;
 
-    //keep track of what node has/was asked for and when
+    //keep track of what node has/was asked for and until when
     fulfilledreqmap_t mapFulfilledRequests;
     CCriticalSection cs_mapFulfilledRequests;
 
     void RemoveFulfilledRequest(const CService& addr, const std::string& strRequest);
 
 public:
-    CNetFulfilledRequestManager() {}
+    CNetFulfilledRequestManager() : mapFulfilledRequests(DEFAULT_MAX_FULFILLED_REQUESTS) {}
 
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
         LOCK(cs_mapFulfilledRequests);
-        READWRITE(mapFulfilledRequests);
+        // stored per node and request with the expiration time as before
+        std::map<CService, std::map<std::string, int64_t> > mapStored;
+        if(!ser_action.ForRead()) {
+            for(const auto& item : mapFulfilledRequests.GetItemList()) {
+                mapStored[item.key.first][item.key.second] = item.nTimeExpire;
+            }
+        }
+        READWRITE(mapStored);
+        if(ser_action.ForRead()) {
+            mapFulfilledRequests.Clear();
+            for(const auto& pairStored : mapStored) {
+                for(const auto& pairRequest : pairStored.second) {
+                    mapFulfilledRequests.Set(std::make_pair(pairStored.first, pairRequest.first), true, pairRequest.second);
+                }
+            }
+        }
     }
 
-    void AddFulfilledRequest(const CService& addr, const std::string& strRequest);
+    /// Remember the request, return false if there is no room left for it even after dropping expired ones
+    bool AddFulfilledRequest(const CService& addr, const std::string& strRequest);
     bool HasFulfilledRequest(const CService& addr, const std::string& strRequest);
 
     void CheckAndRemove();
     void Clear();
 
+    void SetMaxSize(unsigned int nMaxSize);
+
     std::string ToString() const;
 };
 
@@ -541,6 +541,7 @@ void ThreadCheckPrivateSend(CConnman& connman)
 
             mnodeman.ProcessPendingMnbRequests(connman);
             mnodeman.ProcessPendingMnvRequests(connman);
+            governance.ProcessVoteSyncs(connman);
 
             // check if we should activate or ping every few minutes,
             // slightly postpone first run to give net thread a chance to connect to some peers
@@ -0,0 +1,149 @@
+// Copyright (c) 2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/jsonwriter.h"
+
+#include "tinyformat.h"
+
+#include <assert.h>
+
+CJSONWriter::CJSONWriter() : fAfterKey(false)
+{
+}
+
+void CJSONWriter::BeginValue()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (vEmpty.empty())
+        return;
+    if (!vEmpty.back())
+        str += ',';
+    vEmpty.back() = false;
+}
+
+void CJSONWriter::WriteEscaped(const std::string& strIn)
+{
+    str += '"';
+    for (std::string::const_iterator it = strIn.begin(); it != strIn.end(); ++it) {
+        unsigned char ch = *it;
+        switch (ch) {
+        case '"': str += "\\\""; break;
+        case '\\': str += "\\\\"; break;
+        case '\b': str += "\\b"; break;
+        case '\f': str += "\\f"; break;
+        case '\n': str += "\\n"; break;
+        case '\r': str += "\\r"; break;
+        case '\t': str += "\\t"; break;
+        default:
+            // The same characters as UniValue escapes
+            if (ch < 0x20 || ch == 0x7f)
+                str += strprintf("\\u%04x", ch);
+            else
+                str += ch;
+        }
+    }
+    str += '"';
+}
+
+void CJSONWriter::BeginObject()
+{
+    BeginValue();
+    str += '{';
+    vEmpty.push_back(true);
+}
+
+void CJSONWriter::EndObject()
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    vEmpty.pop_back();
+    str += '}';
+}
+
+void CJSONWriter::BeginArray()
+{
+    BeginValue();
+    str += '[';
+    vEmpty.push_back(true);
+}
+
+void CJSONWriter::EndArray()
+{
+    assert(!vEmpty.empty());
+    vEmpty.pop_back();
+    str += ']';
+}
+
+void CJSONWriter::Key(const std::string& strKey)
+{
+    assert(!fAfterKey);
+    BeginValue();
+    WriteEscaped(strKey);
+    str += ':';
+    fAfterKey = true;
+}
+
+void CJSONWriter::Null()
+{
+    BeginValue();
+    str += "null";
+}
+
+void CJSONWriter::Bool(bool fValue)
+{
+    BeginValue();
+    str += fValue ? "true" : "false";
+}
+
+void CJSONWriter::Int(int64_t nValue)
+{
+    BeginValue();
+    str += strprintf("%d", nValue);
+}
+
+void CJSONWriter::String(const std::string& strValue)
+{
+    BeginValue();
+    WriteEscaped(strValue);
+}
+
+void CJSONWriter::Value(const UniValue& value)
+{
+    switch (value.getType()) {
+    case UniValue::VNULL:
+        Null();
+        break;
+    case UniValue::VBOOL:
+        Bool(value.isTrue());
+        break;
+    case UniValue::VNUM:
+        BeginValue();
+        str += value.getValStr();
+        break;
+    case UniValue::VSTR:
+        String(value.getValStr());
+        break;
+    case UniValue::VOBJ: {
+        const std::vector<std::string>& vKeys = value.getKeys();
+        const std::vector<UniValue>& vValues = value.getValues();
+        BeginObject();
+        for (size_t i = 0; i < vKeys.size(); i++) {
+            Key(vKeys[i]);
+            Value(vValues[i]);
+        }
+        EndObject();
+        break;
+    }
+    case UniValue::VARR: {
+        const std::vector<UniValue>& vValues = value.getValues();
+        BeginArray();
+        for (size_t i = 0; i < vValues.size(); i++)
+            Value(vValues[i]);
+        EndArray();
+        break;
+    }
+    }
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPCJSONWRITER_H
+#define BITCOIN_RPCJSONWRITER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <univalue.h>
+
+/**
+ * Writes compact JSON text into a single buffer as it goes, either value by
+ * value or from whole UniValue trees. Unlike UniValue::write, which builds a
+ * string per nested value and copies it into its parent's, every value is
+ * appended in place, so writing a large result costs about one copy of its
+ * text. Commas are put in by the writer; keys are only valid in objects.
+ */
+class CJSONWriter
+{
+private:
+    std::string str;
+    // For every open object or array, whether nothing was written into it yet
+    std::vector<bool> vEmpty;
+    // Whether a key was just written and its value is expected
+    bool fAfterKey;
+
+    void BeginValue();
+    void WriteEscaped(const std::string& strIn);
+
+public:
+    CJSONWriter();
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    void Key(const std::string& strKey);
+
+    void Null();
+    void Bool(bool fValue);
+    void Int(int64_t nValue);
+    void String(const std::string& strValue);
+    void Value(const UniValue& value);
+
+    /** Reserve room for at least nSize bytes of text */
+    void Reserve(size_t nSize) { str.reserve(nSize); }
+    /** The text written so far, to be taken once everything is closed */
+    std::string& GetString() { return str; }
+};
+
+#endif // BITCOIN_RPCJSONWRITER_H
@@ -1117,6 +1117,94 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     return obj;
 }
 
+static UniValue LockStatsHistogram(const std::vector<uint64_t>& vHistogram)
+{
+    UniValue histogram(UniValue::VOBJ);
+    for (size_t i = 0; i < vHistogram.size(); i++) {
+        if (vHistogram[i] == 0)
+            continue;
+        std::string strBucket = i + 1 < vHistogram.size() ? strprintf("<%d", int64_t(1) << i) : strprintf(">=%d", int64_t(1) << (i - 1));
+        histogram.push_back(Pair(strBucket, vHistogram[i]));
+    }
+    return histogram;
+}
+
+static bool CompareLockSiteByWait(const CLockSiteSnapshot& a, const CLockSiteSnapshot& b)
+{
+    return a.nWaitMicros > b.nWaitMicros;
+}
+
+UniValue getlockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getlockstats\n"
+            "Returns how long each LOCK site waited for and held its lock since startup or resetlockstats,\n"
+            "most waiting first. Only recorded with -lockstats.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"enabled\": true|false,     (boolean) Whether lock statistics are being recorded\n"
+            "  \"sites\": [\n"
+            "    {\n"
+            "      \"lock\": \"name\",          (string) The lock as named at the site\n"
+            "      \"site\": \"file:line\",     (string) Where it is taken\n"
+            "      \"acquired\": n,           (numeric) Number of times the site took the lock\n"
+            "      \"contended\": n,          (numeric) Number of times it had to wait for it\n"
+            "      \"wait_us\": n,            (numeric) Total microseconds waited\n"
+            "      \"wait_max_us\": n,        (numeric) Longest wait in microseconds\n"
+            "      \"wait_histogram\": {...}, (json object) Number of acquisitions by microseconds waited\n"
+            "      \"hold_us\": n,            (numeric) Total microseconds held\n"
+            "      \"hold_max_us\": n,        (numeric) Longest hold in microseconds\n"
+            "      \"hold_histogram\": {...}  (json object) Number of acquisitions by microseconds held\n"
+            "    }\n"
+            "    ,...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockstats", "")
+            + HelpExampleRpc("getlockstats", "")
+        );
+
+    std::vector<CLockSiteSnapshot> vStats = GetLockStats();
+    std::sort(vStats.begin(), vStats.end(), CompareLockSiteByWait);
+
+    UniValue sites(UniValue::VARR);
+    BOOST_FOREACH(const CLockSiteSnapshot& stats, vStats) {
+        UniValue site(UniValue::VOBJ);
+        site.push_back(Pair("lock", stats.strName));
+        site.push_back(Pair("site", strprintf("%s:%d", stats.strFile, stats.nLine)));
+        site.push_back(Pair("acquired", stats.nAcquired));
+        site.push_back(Pair("contended", stats.nContended));
+        site.push_back(Pair("wait_us", stats.nWaitMicros));
+        site.push_back(Pair("wait_max_us", stats.nWaitMaxMicros));
+        site.push_back(Pair("wait_histogram", LockStatsHistogram(stats.vWaitHistogram)));
+        site.push_back(Pair("hold_us", stats.nHoldMicros));
+        site.push_back(Pair("hold_max_us", stats.nHoldMaxMicros));
+        site.push_back(Pair("hold_histogram", LockStatsHistogram(stats.vHoldHistogram)));
+        sites.push_back(site);
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("enabled", fLockStats.load()));
+    obj.push_back(Pair("sites", sites));
+    return obj;
+}
+
+UniValue resetlockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "resetlockstats\n"
+            "Clears the statistics returned by getlockstats.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("resetlockstats", "")
+            + HelpExampleRpc("resetlockstats", "")
+        );
+
+    ResetLockStats();
+    return NullUniValue;
+}
+
 UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -1143,6 +1231,9 @@ UniValue getstakingstatus(const JSONRPCRequest& request)
                 "  \"walletunlocked\": true|false,     (boolean) if the wallet is unlocked\n"
                 "  \"mintablecoins\": true|false,      (boolean) if the wallet has mintable coins\n"
                 "  \"enoughcoins\": true|false,        (boolean) if available coins are greater than reserve balance\n"
+                "  \"stakeablecoins\": n,              (numeric) number of coins which can stake right now\n"
+                "  \"pendingstakecoins\": n,           (numeric) number of coins still lacking stake age or confirmations\n"
+                "  \"stakeweight\": x.xxx,             (numeric) total value of the coins which can stake right now\n"
                 "  \"mnsync\": true|false,             (boolean) if masternode data is synced\n"
                 "  \"staking status\": true|false,     (boolean) if the wallet is staking or not\n"
                 "  \"staking tpos txid\" ,             (string)  if the wallet is tposing or not\n"
@@ -1156,6 +1247,9 @@ UniValue getstakingstatus(const JSONRPCRequest& request)
         obj.push_back(Pair("walletunlocked", !pwalletMain->IsLocked(true)));
         obj.push_back(Pair("mintablecoins", pwalletMain->MintableCoins()));
         obj.push_back(Pair("enoughcoins", pwalletMain->GetBalance() > 0));
+        obj.push_back(Pair("stakeablecoins", pwalletMain->GetStakeInputs()));
+        obj.push_back(Pair("pendingstakecoins", pwalletMain->GetPendingStakeInputs()));
+        obj.push_back(Pair("stakeweight", ValueFromAmount(pwalletMain->GetStakeWeight())));
     }
     obj.push_back(Pair("mnsync", masternodeSync.IsSynced()));
     bool nStaking = false;
@@ -1172,6 +1266,8 @@ static const CRPCCommand commands[] =
     { "control",            "debug",                  &debug,                  true,  {} },
     { "control",            "getinfo",                &getinfo,                true,  {} }, /* uses wallet if enabled */
     { "control",            "getmemoryinfo",          &getmemoryinfo,          true,  {} },
+    { "control",            "getlockstats",           &getlockstats,           true,  {} },
+    { "control",            "resetlockstats",         &resetlockstats,         true,  {} },
     { "util",               "validateaddress",        &validateaddress,        true,  {"address"} }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         true,  {"nrequired","keys"} },
     { "util",               "verifymessage",          &verifymessage,          true,  {"address","signature","message"} },
@@ -66,6 +66,23 @@ UniValue ping(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue MsgProcessStatsToJSON(const mapMsgCmdProcessStats& mapStats)
+{
+    UniValue ret(UniValue::VOBJ);
+    BOOST_FOREACH(const mapMsgCmdProcessStats::value_type &i, mapStats) {
+        if (i.second.nCount == 0)
+            continue;
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("count", i.second.nCount));
+        obj.push_back(Pair("bytes", i.second.nBytes));
+        obj.push_back(Pair("failed", i.second.nFailed));
+        obj.push_back(Pair("time_us", i.second.nTotalMicros));
+        obj.push_back(Pair("max_us", i.second.nMaxMicros));
+        ret.push_back(Pair(i.first, obj));
+    }
+    return ret;
+}
+
 UniValue getpeerinfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -109,6 +126,10 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             "    \"bytesrecv_per_msg\": {\n"
             "       \"addr\": n,              (numeric) The total bytes received aggregated by message type\n"
             "       ...\n"
+            "    },\n"
+            "    \"processed_per_msg\": {\n"
+            "       \"addr\": {...},          (json object) Time spent processing the messages of each type, as in getmessagestats\n"
+            "       ...\n"
             "    }\n"
             "  }\n"
             "  ,...\n"
@@ -181,6 +202,7 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
                 recvPerMsgCmd.push_back(Pair(i.first, i.second));
         }
         obj.push_back(Pair("bytesrecv_per_msg", recvPerMsgCmd));
+        obj.push_back(Pair("processed_per_msg", MsgProcessStatsToJSON(stats.mapProcessStatsPerMsgCmd)));
 
         ret.push_back(obj);
     }
@@ -324,6 +346,34 @@ UniValue getaddednodeinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue getmessagestats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            "getmessagestats\n"
+            "\nReturns the time spent processing received messages since startup, by message type\n"
+            "and over all peers. Unknown message types are counted as \"*other*\".\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"addr\": {\n"
+            "    \"count\": n,      (numeric) Number of messages processed\n"
+            "    \"bytes\": n,      (numeric) Total size of their payloads\n"
+            "    \"failed\": n,     (numeric) Number which failed to process or threw\n"
+            "    \"time_us\": n,    (numeric) Total microseconds spent processing them\n"
+            "    \"max_us\": n      (numeric) Longest time spent on one in microseconds\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmessagestats", "")
+            + HelpExampleRpc("getmessagestats", "")
+       );
+
+    mapMsgCmdProcessStats mapStats;
+    GetMessageProcessStats(mapStats);
+    return MsgProcessStatsToJSON(mapStats);
+}
+
 UniValue getnettotals(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 0)
@@ -611,6 +661,7 @@ static const CRPCCommand commands[] =
     { "network",            "disconnectnode",         &disconnectnode,         true,  {"address"} },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true,  {"node"} },
     { "network",            "getnettotals",           &getnettotals,           true,  {} },
+    { "network",            "getmessagestats",        &getmessagestats,        true,  {} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         true,  {} },
     { "network",            "setban",                 &setban,                 true,  {"subnet", "command", "bantime", "absolute"} },
     { "network",            "listbanned",             &listbanned,             true,  {} },
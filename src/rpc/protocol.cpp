@@ -7,6 +7,7 @@
 #include "rpc/protocol.h"
 
 #include "random.h"
+#include "rpc/jsonwriter.h"
 #include "tinyformat.h"
 #include "util.h"
 #include "utilstrencodings.h"
@@ -46,10 +47,27 @@ UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const Un
     return reply;
 }
 
+void JSONRPCWriteReply(CJSONWriter& writer, const UniValue& result, const UniValue& error, const UniValue& id)
+{
+    writer.BeginObject();
+    writer.Key("result");
+    if (!error.isNull())
+        writer.Null();
+    else
+        writer.Value(result);
+    writer.Key("error");
+    writer.Value(error);
+    writer.Key("id");
+    writer.Value(id);
+    writer.EndObject();
+}
+
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id)
 {
-    UniValue reply = JSONRPCReplyObj(result, error, id);
-    return reply.write() + "\n";
+    CJSONWriter writer;
+    JSONRPCWriteReply(writer, result, error, id);
+    writer.GetString() += "\n";
+    return std::move(writer.GetString());
 }
 
 UniValue JSONRPCError(int code, const std::string& message)
@@ -14,6 +14,8 @@
 
 #include <univalue.h>
 
+class CJSONWriter;
+
 //! HTTP status codes
 enum HTTPStatusCode
 {
@@ -79,6 +81,8 @@ enum RPCErrorCode
 
 UniValue JSONRPCRequestObj(const std::string& strMethod, const UniValue& params, const UniValue& id);
 UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const UniValue& id);
+/** Write the reply JSONRPCReplyObj would build, without copying result into it */
+void JSONRPCWriteReply(CJSONWriter& writer, const UniValue& result, const UniValue& error, const UniValue& id);
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id);
 UniValue JSONRPCError(int code, const std::string& message);
 
@@ -9,6 +9,7 @@
 #include "base58.h"
 #include "init.h"
 #include "random.h"
+#include "rpc/jsonwriter.h"
 #include "sync.h"
 #include "ui_interface.h"
 #include "util.h"
@@ -265,6 +266,100 @@ UniValue stop(const JSONRPCRequest& jsonRequest)
     return "Polis Core server stopping";
 }
 
+/** What the calls of one method took, see getrpcstats */
+struct CRPCMethodStats
+{
+    uint64_t nCalls;
+    uint64_t nErrors;
+    int nActive;
+    int nMaxActive;
+    int64_t nTotalMicros;
+    int64_t nMaxMicros;
+
+    CRPCMethodStats() : nCalls(0), nErrors(0), nActive(0), nMaxActive(0), nTotalMicros(0), nMaxMicros(0) {}
+};
+
+static CCriticalSection cs_rpcStats;
+static std::map<std::string, CRPCMethodStats> mapRPCStats;
+
+/** Accounts for one call of a method from its start until it goes out of scope */
+class CRPCCallStats
+{
+private:
+    const std::string& strMethod;
+    int64_t nStart;
+    bool fSucceeded;
+
+public:
+    CRPCCallStats(const std::string& strMethodIn) : strMethod(strMethodIn), nStart(GetTimeMicros()), fSucceeded(false)
+    {
+        LOCK(cs_rpcStats);
+        CRPCMethodStats& stats = mapRPCStats[strMethod];
+        stats.nActive++;
+        stats.nMaxActive = std::max(stats.nMaxActive, stats.nActive);
+    }
+
+    void Succeeded() { fSucceeded = true; }
+
+    ~CRPCCallStats()
+    {
+        int64_t nMicros = GetTimeMicros() - nStart;
+        LOCK(cs_rpcStats);
+        CRPCMethodStats& stats = mapRPCStats[strMethod];
+        stats.nActive--;
+        stats.nCalls++;
+        if (!fSucceeded)
+            stats.nErrors++;
+        stats.nTotalMicros += nMicros;
+        stats.nMaxMicros = std::max(stats.nMaxMicros, nMicros);
+    }
+};
+
+UniValue getrpcstats(const JSONRPCRequest& jsonRequest)
+{
+    if (jsonRequest.fHelp || jsonRequest.params.size() != 0)
+        throw std::runtime_error(
+            "getrpcstats\n"
+            "\nReturns how often each RPC method was called since startup, how long the calls took\n"
+            "and how many of them ran at the same time.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"method\": {\n"
+            "    \"calls\": n,         (numeric) Number of calls which finished\n"
+            "    \"errors\": n,        (numeric) Number of them which returned an error\n"
+            "    \"active\": n,        (numeric) Number of calls running now\n"
+            "    \"max_active\": n,    (numeric) Most calls which ran at the same time\n"
+            "    \"time_us\": n,       (numeric) Total microseconds the finished calls took\n"
+            "    \"max_us\": n         (numeric) Longest call in microseconds\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcstats", "")
+            + HelpExampleRpc("getrpcstats", "")
+        );
+
+    std::map<std::string, CRPCMethodStats> mapStats;
+    {
+        LOCK(cs_rpcStats);
+        mapStats = mapRPCStats;
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    BOOST_FOREACH(const PAIRTYPE(std::string, CRPCMethodStats)& item, mapStats) {
+        const CRPCMethodStats& stats = item.second;
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("calls", stats.nCalls));
+        obj.push_back(Pair("errors", stats.nErrors));
+        obj.push_back(Pair("active", stats.nActive));
+        obj.push_back(Pair("max_active", stats.nMaxActive));
+        obj.push_back(Pair("time_us", stats.nTotalMicros));
+        obj.push_back(Pair("max_us", stats.nMaxMicros));
+        ret.push_back(Pair(item.first, obj));
+    }
+    return ret;
+}
+
 /**
  * Call Table
  */
@@ -274,6 +369,7 @@ static const CRPCCommand vRPCCommands[] =
     /* Overall control/query calls */
     { "control",            "help",                   &help,                   true,  {"command"}  },
     { "control",            "stop",                   &stop,                   true,  {}  },
+    { "control",            "getrpcstats",            &getrpcstats,            true,  {}  },
 };
 
 CRPCTable::CRPCTable()
@@ -389,37 +485,38 @@ void JSONRPCRequest::parse(const UniValue& valRequest)
         throw JSONRPCError(RPC_INVALID_REQUEST, "Params must be an array or object");
 }
 
-static UniValue JSONRPCExecOne(const UniValue& req)
+static void JSONRPCExecOne(CJSONWriter& writer, const UniValue& req)
 {
-    UniValue rpc_result(UniValue::VOBJ);
-
     JSONRPCRequest jreq;
     try {
         jreq.parse(req);
 
         UniValue result = tableRPC.execute(jreq);
-        rpc_result = JSONRPCReplyObj(result, NullUniValue, jreq.id);
+        JSONRPCWriteReply(writer, result, NullUniValue, jreq.id);
     }
     catch (const UniValue& objError)
     {
-        rpc_result = JSONRPCReplyObj(NullUniValue, objError, jreq.id);
+        JSONRPCWriteReply(writer, NullUniValue, objError, jreq.id);
     }
     catch (const std::exception& e)
     {
-        rpc_result = JSONRPCReplyObj(NullUniValue,
-                                     JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        JSONRPCWriteReply(writer, NullUniValue,
+                          JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
     }
-
-    return rpc_result;
 }
 
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
-    UniValue ret(UniValue::VARR);
+    // Each reply is written as soon as its call returns, so only one
+    // result at a time exists as a UniValue
+    CJSONWriter writer;
+    writer.BeginArray();
     for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+        JSONRPCExecOne(writer, vReq[reqIdx]);
+    writer.EndArray();
 
-    return ret.write() + "\n";
+    writer.GetString() += "\n";
+    return std::move(writer.GetString());
 }
 
 /**
@@ -480,14 +577,18 @@ UniValue CRPCTable::execute(const JSONRPCRequest &request) const
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    CRPCCallStats callStats(pcmd->name);
     try
     {
         // Execute, convert arguments to array if necessary
+        UniValue result;
         if (request.params.isObject()) {
-            return pcmd->actor(transformNamedArguments(request, pcmd->argNames));
+            result = pcmd->actor(transformNamedArguments(request, pcmd->argNames));
         } else {
-            return pcmd->actor(request);
+            result = pcmd->actor(request);
         }
+        callStats.Succeeded();
+        return result;
     }
     catch (const std::exception& e)
     {
@@ -4,6 +4,8 @@
 
 #include <sync.h>
 
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <set>
 #include <util.h>
@@ -22,6 +24,125 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+std::atomic<bool> fLockStats(false);
+
+// Enough for every LOCK in the tree; sites beyond it go unrecorded
+static const size_t LOCKSTATS_SITES = 4096;
+static CLockSiteStats vLockSites[LOCKSTATS_SITES];
+
+int64_t LockStatsTimeMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int LockStatsBucket(int64_t nMicros)
+{
+    int nBucket = 0;
+    while (nBucket < LOCKSTATS_BUCKETS - 1 && nMicros >= (int64_t(1) << nBucket))
+        nBucket++;
+    return nBucket;
+}
+
+static void UpdateMax(std::atomic<uint64_t>& nMax, uint64_t nValue)
+{
+    uint64_t nPrev = nMax.load(std::memory_order_relaxed);
+    while (nPrev < nValue && !nMax.compare_exchange_weak(nPrev, nValue, std::memory_order_relaxed)) {}
+}
+
+void CLockSiteStats::AddWait(int64_t nMicros, bool fContended)
+{
+    if (nMicros < 0)
+        nMicros = 0;
+    nAcquired.fetch_add(1, std::memory_order_relaxed);
+    if (fContended) {
+        nContended.fetch_add(1, std::memory_order_relaxed);
+        nWaitMicros.fetch_add(nMicros, std::memory_order_relaxed);
+        UpdateMax(nWaitMaxMicros, nMicros);
+    }
+    vWaitHistogram[LockStatsBucket(nMicros)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void CLockSiteStats::AddHold(int64_t nMicros)
+{
+    if (nMicros < 0)
+        nMicros = 0;
+    nHoldMicros.fetch_add(nMicros, std::memory_order_relaxed);
+    UpdateMax(nHoldMaxMicros, nMicros);
+    vHoldHistogram[LockStatsBucket(nMicros)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void CLockSiteStats::Reset()
+{
+    nAcquired = 0;
+    nContended = 0;
+    nWaitMicros = 0;
+    nWaitMaxMicros = 0;
+    nHoldMicros = 0;
+    nHoldMaxMicros = 0;
+    for (int i = 0; i < LOCKSTATS_BUCKETS; i++) {
+        vWaitHistogram[i] = 0;
+        vHoldHistogram[i] = 0;
+    }
+}
+
+CLockSiteStats* GetLockSiteStats(const char* pszName, const char* pszFile, int nLine)
+{
+    // Open addressing on the site; a slot belongs to a site once its file is
+    // set, and its line is published right after, so racing claimants of the
+    // same slot wait for that rather than take another one.
+    size_t nSlot = (std::hash<const void*>()(pszFile) ^ (size_t(nLine) * 2654435761u)) % LOCKSTATS_SITES;
+    for (size_t i = 0; i < LOCKSTATS_SITES; i++) {
+        CLockSiteStats& site = vLockSites[(nSlot + i) % LOCKSTATS_SITES];
+        const char* pszSiteFile = site.pszFile.load(std::memory_order_acquire);
+        if (pszSiteFile == NULL) {
+            if (site.pszFile.compare_exchange_strong(pszSiteFile, pszFile, std::memory_order_acq_rel)) {
+                site.pszName.store(pszName, std::memory_order_relaxed);
+                site.nLine.store(nLine, std::memory_order_release);
+                return &site;
+            }
+        }
+        if (pszSiteFile != pszFile)
+            continue;
+        int nSiteLine;
+        while ((nSiteLine = site.nLine.load(std::memory_order_acquire)) == 0) {}
+        if (nSiteLine == nLine)
+            return &site;
+    }
+    return NULL;
+}
+
+std::vector<CLockSiteSnapshot> GetLockStats()
+{
+    std::vector<CLockSiteSnapshot> vStats;
+    for (size_t i = 0; i < LOCKSTATS_SITES; i++) {
+        const CLockSiteStats& site = vLockSites[i];
+        if (site.nLine.load(std::memory_order_acquire) == 0 || site.nAcquired == 0)
+            continue;
+        CLockSiteSnapshot snapshot;
+        snapshot.strName = site.pszName.load(std::memory_order_relaxed);
+        snapshot.strFile = site.pszFile.load(std::memory_order_relaxed);
+        snapshot.nLine = site.nLine;
+        snapshot.nAcquired = site.nAcquired;
+        snapshot.nContended = site.nContended;
+        snapshot.nWaitMicros = site.nWaitMicros;
+        snapshot.nWaitMaxMicros = site.nWaitMaxMicros;
+        snapshot.nHoldMicros = site.nHoldMicros;
+        snapshot.nHoldMaxMicros = site.nHoldMaxMicros;
+        for (int j = 0; j < LOCKSTATS_BUCKETS; j++) {
+            snapshot.vWaitHistogram.push_back(site.vWaitHistogram[j]);
+            snapshot.vHoldHistogram.push_back(site.vHoldHistogram[j]);
+        }
+        vStats.push_back(snapshot);
+    }
+    return vStats;
+}
+
+void ResetLockStats()
+{
+    for (size_t i = 0; i < LOCKSTATS_SITES; i++)
+        vLockSites[i].Reset();
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
@@ -8,6 +8,11 @@
 
 #include "threadsafety.h"
 
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
@@ -111,16 +116,102 @@ typedef boost::condition_variable CConditionVariable;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * Lock statistics (-lockstats): how often each LOCK/TRY_LOCK site takes its
+ * lock, how long it waits when the lock is contended and how long it holds
+ * it, with histograms in power of two microsecond buckets. The sites live in
+ * a fixed size table which is filled without locking, so recording costs two
+ * clock reads and a few atomic increments per acquisition.
+ */
+extern std::atomic<bool> fLockStats;
+
+static const bool DEFAULT_LOCKSTATS = false;
+
+static const int LOCKSTATS_BUCKETS = 24;
+
+class CLockSiteStats
+{
+public:
+    std::atomic<const char*> pszFile;
+    std::atomic<int> nLine;
+    std::atomic<const char*> pszName;
+
+    std::atomic<uint64_t> nAcquired;
+    std::atomic<uint64_t> nContended;
+    std::atomic<uint64_t> nWaitMicros;
+    std::atomic<uint64_t> nWaitMaxMicros;
+    std::atomic<uint64_t> nHoldMicros;
+    std::atomic<uint64_t> nHoldMaxMicros;
+    // Bucket i counts durations below 2^i microseconds, the last one the rest
+    std::atomic<uint64_t> vWaitHistogram[LOCKSTATS_BUCKETS];
+    std::atomic<uint64_t> vHoldHistogram[LOCKSTATS_BUCKETS];
+
+    void AddWait(int64_t nMicros, bool fContended);
+    void AddHold(int64_t nMicros);
+    void Reset();
+};
+
+/** A copy of one site's statistics, see GetLockStats */
+struct CLockSiteSnapshot
+{
+    std::string strName;
+    std::string strFile;
+    int nLine;
+    uint64_t nAcquired;
+    uint64_t nContended;
+    uint64_t nWaitMicros;
+    uint64_t nWaitMaxMicros;
+    uint64_t nHoldMicros;
+    uint64_t nHoldMaxMicros;
+    std::vector<uint64_t> vWaitHistogram;
+    std::vector<uint64_t> vHoldHistogram;
+};
+
+/** Microseconds of a monotonic clock, for lock statistics */
+int64_t LockStatsTimeMicros();
+/** The statistics of a lock site, or NULL if the table is full */
+CLockSiteStats* GetLockSiteStats(const char* pszName, const char* pszFile, int nLine);
+/** Copy the statistics of every site which took its lock since the last reset */
+std::vector<CLockSiteSnapshot> GetLockStats();
+/** Start over counting for every site */
+void ResetLockStats();
+
 /** Wrapper around boost::unique_lock<Mutex> */
 template <typename Mutex>
 class SCOPED_LOCKABLE CMutexLock
 {
 private:
     boost::unique_lock<Mutex> lock;
+    // Set while lock statistics are being recorded for this lock
+    CLockSiteStats* pstats;
+    int64_t nLockedAt;
+
+    void EnterWithStats(const char* pszName, const char* pszFile, int nLine)
+    {
+        pstats = GetLockSiteStats(pszName, pszFile, nLine);
+        if (lock.try_lock()) {
+            nLockedAt = LockStatsTimeMicros();
+            if (pstats)
+                pstats->AddWait(0, false);
+            return;
+        }
+#ifdef DEBUG_LOCKCONTENTION
+        PrintLockContention(pszName, pszFile, nLine);
+#endif
+        int64_t nStart = LockStatsTimeMicros();
+        lock.lock();
+        nLockedAt = LockStatsTimeMicros();
+        if (pstats)
+            pstats->AddWait(nLockedAt - nStart, true);
+    }
 
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
+        if (fLockStats.load(std::memory_order_relaxed)) {
+            EnterWithStats(pszName, pszFile, nLine);
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (!lock.try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
@@ -137,11 +228,17 @@ private:
         lock.try_lock();
         if (!lock.owns_lock())
             LeaveCritical();
+        else if (fLockStats.load(std::memory_order_relaxed)) {
+            pstats = GetLockSiteStats(pszName, pszFile, nLine);
+            nLockedAt = LockStatsTimeMicros();
+            if (pstats)
+                pstats->AddWait(0, false);
+        }
         return lock.owns_lock();
     }
 
 public:
-    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(mutexIn) : lock(mutexIn, boost::defer_lock)
+    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(mutexIn) : lock(mutexIn, boost::defer_lock), pstats(NULL), nLockedAt(0)
     {
         if (fTry)
             TryEnter(pszName, pszFile, nLine);
@@ -149,7 +246,7 @@ public:
             Enter(pszName, pszFile, nLine);
     }
 
-    CMutexLock(Mutex* pmutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(pmutexIn)
+    CMutexLock(Mutex* pmutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(pmutexIn) : pstats(NULL), nLockedAt(0)
     {
         if (!pmutexIn) return;
 
@@ -162,8 +259,11 @@ public:
 
     ~CMutexLock() UNLOCK_FUNCTION()
     {
-        if (lock.owns_lock())
+        if (lock.owns_lock()) {
+            if (pstats)
+                pstats->AddHold(LockStatsTimeMicros() - nLockedAt);
             LeaveCritical();
+        }
     }
 
     operator bool()
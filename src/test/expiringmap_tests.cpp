@@ -0,0 +1,154 @@
+// Copyright (c) 2018 The Polis Core developers
+
+#include "expiringmap.h"
+
+#include "test/test_polis.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(expiringmap_tests, BasicTestingSetup)
+
+bool Compare(const ExpiringMap<int,int>& emap1, const ExpiringMap<int,int>& emap2)
+{
+    if(emap1.GetSize() != emap2.GetSize()) {
+        return false;
+    }
+
+    std::vector<ExpiringMap<int,int>::item_t> items = emap1.GetItemList();
+    for(const auto& item : items) {
+        int val = 0;
+        if(!emap2.Get(item.key, val)) {
+            return false;
+        }
+        if(item.value != val || item.nTimeExpire != emap2.GetExpireTime(item.key)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(expiringmap_test)
+{
+    // create an ExpiringMap limited to 10 items
+    ExpiringMap<int,int> emapTest1(10);
+
+    BOOST_CHECK(emapTest1.GetMaxSize() == 10);
+    BOOST_CHECK(emapTest1.GetSize() == 0);
+
+    // insert (-1, -1) expiring at 1000
+    BOOST_CHECK(emapTest1.Insert(-1, -1, 1000) == true);
+    BOOST_CHECK(emapTest1.GetSize() == 1);
+    BOOST_CHECK(emapTest1.HasKey(-1) == true);
+    BOOST_CHECK(emapTest1.GetExpireTime(-1) == 1000);
+    BOOST_CHECK(emapTest1.GetExpireTime(-2) == 0);
+
+    // make sure that insert fails to update already existing key
+    BOOST_CHECK(emapTest1.Insert(-1, -2, 2000) == false);
+    int nValRet = 0;
+    BOOST_CHECK(emapTest1.Get(-1, nValRet) == true);
+    BOOST_CHECK(nValRet == -1);
+    BOOST_CHECK(emapTest1.GetExpireTime(-1) == 1000);
+
+    // but set does
+    emapTest1.Set(-1, -2, 2000);
+    BOOST_CHECK(emapTest1.Get(-1, nValRet) == true);
+    BOOST_CHECK(nValRet == -2);
+    BOOST_CHECK(emapTest1.GetExpireTime(-1) == 2000);
+    BOOST_CHECK(emapTest1.GetSize() == 1);
+
+    // add 10 items, expiring after -1
+    for(int i = 0; i < 10; ++i) {
+        BOOST_CHECK(emapTest1.Insert(i, i, 3000 + i) == (i < 9));
+    }
+
+    // the map is full, new keys are refused instead of evicting any item
+    BOOST_CHECK(emapTest1.IsFull());
+    BOOST_CHECK(emapTest1.GetSize() == 10);
+    BOOST_CHECK(emapTest1.HasKey(-1) == true);
+    BOOST_CHECK(emapTest1.HasKey(9) == false);
+    BOOST_CHECK(emapTest1.Set(9, 9, 3009) == false);
+
+    // but known keys can still be updated
+    BOOST_CHECK(emapTest1.Set(-1, -1, 2500) == true);
+    BOOST_CHECK(emapTest1.GetExpireTime(-1) == 2500);
+
+    // removing the expired item makes room
+    BOOST_CHECK(emapTest1.RemoveExpired(2600) == 1);
+    BOOST_CHECK(emapTest1.IsFull() == false);
+    BOOST_CHECK(emapTest1.Insert(9, 9, 3009) == true);
+    BOOST_CHECK(emapTest1.GetSize() == 10);
+    for(int i = 0; i < 10; ++i) {
+        int nVal = 0;
+        BOOST_CHECK(emapTest1.Get(i, nVal) == true);
+        BOOST_CHECK(nVal == i);
+    }
+
+    // erase an item
+    emapTest1.Erase(5);
+    BOOST_CHECK(emapTest1.GetSize() == 9);
+    BOOST_CHECK(emapTest1.HasKey(5) == false);
+
+    // nothing expired before 3000
+    BOOST_CHECK(emapTest1.RemoveExpired(3000) == 0);
+    BOOST_CHECK(emapTest1.GetSize() == 9);
+
+    // items 0, 1 and 2 expired before 3003
+    BOOST_CHECK(emapTest1.RemoveExpired(3003) == 3);
+    BOOST_CHECK(emapTest1.GetSize() == 6);
+    int expected[] = { 3, 4, 6, 7, 8, 9 };
+    for(size_t i = 0; i < 6; ++i) {
+        int nVal = 0;
+        int eVal = expected[i];
+        BOOST_CHECK(emapTest1.Get(eVal, nVal) == true);
+        BOOST_CHECK(nVal == eVal);
+    }
+
+    // moving an item later keeps it past its old expiration time
+    emapTest1.Set(3, 3, 5000);
+    BOOST_CHECK(emapTest1.RemoveExpired(3005) == 1);
+    BOOST_CHECK(emapTest1.HasKey(3) == true);
+    BOOST_CHECK(emapTest1.HasKey(4) == false);
+
+    // test serialization
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << emapTest1;
+
+    ExpiringMap<int,int> emapTest2(10);
+    ss >> emapTest2;
+
+    BOOST_CHECK(Compare(emapTest1, emapTest2));
+
+    // test copy constructor
+    ExpiringMap<int,int> emapTest3(emapTest1);
+    BOOST_CHECK(Compare(emapTest1, emapTest3));
+
+    // test assignment operator
+    ExpiringMap<int,int> emapTest4;
+    emapTest4 = emapTest1;
+    BOOST_CHECK(Compare(emapTest1, emapTest4));
+
+    // erase a range of keys
+    BOOST_CHECK(emapTest1.EraseFrom(7, [](int key) { return key < 9; }) == 2);
+    BOOST_CHECK(emapTest1.HasKey(7) == false);
+    BOOST_CHECK(emapTest1.HasKey(8) == false);
+    BOOST_CHECK(emapTest1.HasKey(9) == true);
+    BOOST_CHECK(emapTest1.GetSize() == 3);
+
+    // a smaller limit when reading keeps the items expiring last
+    ExpiringMap<int,int> emapTest5(2);
+    CDataStream ss2(SER_NETWORK, PROTOCOL_VERSION);
+    ss2 << emapTest1;
+    ss2 >> emapTest5;
+    BOOST_CHECK(emapTest5.GetSize() == 2);
+    BOOST_CHECK(emapTest5.HasKey(9) == true);
+    BOOST_CHECK(emapTest5.HasKey(3) == true);
+
+    // shrinking the limit evicts the items closest to expiring
+    emapTest1.SetMaxSize(2);
+    BOOST_CHECK(emapTest1.GetSize() == 2);
+    BOOST_CHECK(emapTest1.HasKey(9) == true);
+    BOOST_CHECK(emapTest1.HasKey(3) == true);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,202 @@
+// Copyright (c) 2018 The Polis Core developers
+
+#include "governance.h"
+#include "governance-object.h"
+#include "arith_uint256.h"
+
+#include "test/test_random.h"
+#include "test/test_polis.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_tests, BasicTestingSetup)
+
+class TestGovernanceObject
+{
+public:
+    static void SetVote(CGovernanceObject& govobj, const COutPoint& outpoint, int nSignal, vote_outcome_enum_t eOutcome, int64_t nTime)
+    {
+        LOCK(govobj.cs);
+        govobj.SetCurrentMNVote(outpoint, nSignal, vote_instance_t(eOutcome, nTime, nTime));
+    }
+
+    static void EraseVotes(CGovernanceObject& govobj, const COutPoint& outpoint)
+    {
+        LOCK(govobj.cs);
+        CGovernanceObject::vote_m_it it = govobj.mapCurrentMNVotes.find(outpoint);
+        if(it != govobj.mapCurrentMNVotes.end()) {
+            govobj.EraseCurrentMNVotes(it);
+        }
+    }
+
+    static void RebuildTally(CGovernanceObject& govobj)
+    {
+        govobj.RebuildVoteTally();
+    }
+
+    // Count the matching vote instances the slow way, as the tally used to be computed
+    static int Recount(const CGovernanceObject& govobj, int nSignal, vote_outcome_enum_t eOutcome)
+    {
+        LOCK(govobj.cs);
+        int nCount = 0;
+        for(const auto& votepair : govobj.mapCurrentMNVotes) {
+            vote_instance_m_cit it = votepair.second.mapInstances.find(nSignal);
+            if(it != votepair.second.mapInstances.end() && it->second.eOutcome == eOutcome) {
+                ++nCount;
+            }
+        }
+        return nCount;
+    }
+
+    static bool CheckTally(const CGovernanceObject& govobj)
+    {
+        for(int nSignal = VOTE_SIGNAL_FUNDING; nSignal <= MAX_SUPPORTED_VOTE_SIGNAL; ++nSignal) {
+            vote_signal_enum_t eSignal = vote_signal_enum_t(nSignal);
+            int nYes = Recount(govobj, nSignal, VOTE_OUTCOME_YES);
+            int nNo = Recount(govobj, nSignal, VOTE_OUTCOME_NO);
+            int nAbstain = Recount(govobj, nSignal, VOTE_OUTCOME_ABSTAIN);
+            if(govobj.GetYesCount(eSignal) != nYes ||
+               govobj.GetNoCount(eSignal) != nNo ||
+               govobj.GetAbstainCount(eSignal) != nAbstain ||
+               govobj.GetAbsoluteYesCount(eSignal) != nYes - nNo ||
+               govobj.GetAbsoluteNoCount(eSignal) != nNo - nYes) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(governance_vote_tally_test)
+{
+    CGovernanceObject govobj;
+    BOOST_CHECK(TestGovernanceObject::CheckTally(govobj));
+    BOOST_CHECK(govobj.GetYesCount(VOTE_SIGNAL_FUNDING) == 0);
+
+    // add
+    TestGovernanceObject::SetVote(govobj, GetTestMasternodeOutpoint(0), VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1);
+    TestGovernanceObject::SetVote(govobj, GetTestMasternodeOutpoint(1), VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1);
+    TestGovernanceObject::SetVote(govobj, GetTestMasternodeOutpoint(2), VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 1);
+    TestGovernanceObject::SetVote(govobj, GetTestMasternodeOutpoint(0), VOTE_SIGNAL_DELETE, VOTE_OUTCOME_ABSTAIN, 1);
+    BOOST_CHECK(TestGovernanceObject::CheckTally(govobj));
+    BOOST_CHECK(govobj.GetYesCount(VOTE_SIGNAL_FUNDING) == 2);
+    BOOST_CHECK(govobj.GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING) == 1);
+    BOOST_CHECK(govobj.GetAbstainCount(VOTE_SIGNAL_DELETE) == 1);
+
+    // replace
+    TestGovernanceObject::SetVote(govobj, GetTestMasternodeOutpoint(1), VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 2);
+    BOOST_CHECK(TestGovernanceObject::CheckTally(govobj));
+    BOOST_CHECK(govobj.GetYesCount(VOTE_SIGNAL_FUNDING) == 1);
+    BOOST_CHECK(govobj.GetAbsoluteNoCount(VOTE_SIGNAL_FUNDING) == 1);
+
+    // a placeholder instance is not counted
+    TestGovernanceObject::SetVote(govobj, GetTestMasternodeOutpoint(2), VOTE_SIGNAL_VALID, VOTE_OUTCOME_NONE, 2);
+    BOOST_CHECK(TestGovernanceObject::CheckTally(govobj));
+
+    // clear
+    TestGovernanceObject::EraseVotes(govobj, GetTestMasternodeOutpoint(0));
+    BOOST_CHECK(TestGovernanceObject::CheckTally(govobj));
+    BOOST_CHECK(govobj.GetYesCount(VOTE_SIGNAL_FUNDING) == 0);
+    BOOST_CHECK(govobj.GetAbstainCount(VOTE_SIGNAL_DELETE) == 0);
+    BOOST_CHECK(govobj.GetAbsoluteNoCount(VOTE_SIGNAL_FUNDING) == 2);
+
+    // random adds, replaces and clears keep the tally in step with a recount
+    seed_insecure_rand(true);
+    for(int i = 0; i < 1000; ++i) {
+        COutPoint outpoint = GetTestMasternodeOutpoint(insecure_rand() % 20);
+        if(insecure_rand() % 8 == 0) {
+            TestGovernanceObject::EraseVotes(govobj, outpoint);
+        }
+        else {
+            int nSignal = VOTE_SIGNAL_FUNDING + insecure_rand() % MAX_SUPPORTED_VOTE_SIGNAL;
+            vote_outcome_enum_t eOutcome = vote_outcome_enum_t(insecure_rand() % (MAX_SUPPORTED_VOTE_OUTCOME + 1));
+            TestGovernanceObject::SetVote(govobj, outpoint, nSignal, eOutcome, i + 3);
+        }
+        BOOST_CHECK(TestGovernanceObject::CheckTally(govobj));
+    }
+
+    // a full rebuild finds the same counts
+    TestGovernanceObject::RebuildTally(govobj);
+    BOOST_CHECK(TestGovernanceObject::CheckTally(govobj));
+}
+
+class TestGovernanceManager
+{
+public:
+    static void SetVoteCacheSize(CGovernanceManager& govman, size_t nSize)
+    {
+        LOCK(govman.cs);
+        govman.cmapVoteToObject.SetMaxSize(nSize);
+    }
+
+    static bool AddVoteReference(CGovernanceManager& govman, const uint256& nHashVote, CGovernanceObject* pGovobj)
+    {
+        LOCK(govman.cs);
+        return govman.AddVoteReference(nHashVote, pGovobj);
+    }
+
+    static void RemoveVoteReferences(CGovernanceManager& govman, CGovernanceObject* pGovobj)
+    {
+        LOCK(govman.cs);
+        govman.RemoveVoteReferences(pGovobj);
+    }
+
+    static size_t GetVoteCacheSize(const CGovernanceManager& govman)
+    {
+        LOCK(govman.cs);
+        return govman.cmapVoteToObject.GetSize();
+    }
+
+    // Number of vote hashes kept for the object, 0 if it has no set
+    static size_t GetObjectVoteHashCount(const CGovernanceManager& govman, const CGovernanceObject& govobj)
+    {
+        LOCK(govman.cs);
+        std::map<uint256, CGovernanceManager::hash_s_t>::const_iterator it = govman.mapObjectVoteHashes.find(govobj.GetHash());
+        return it == govman.mapObjectVoteHashes.end() ? 0 : it->second.size();
+    }
+
+    static size_t GetObjectCount(const CGovernanceManager& govman)
+    {
+        LOCK(govman.cs);
+        return govman.mapObjectVoteHashes.size();
+    }
+};
+
+BOOST_AUTO_TEST_CASE(governance_vote_references_test)
+{
+    CGovernanceManager govman;
+    TestGovernanceManager::SetVoteCacheSize(govman, 10);
+
+    CGovernanceObject govobj1(uint256(), 1, 1000, uint256(), "");
+    CGovernanceObject govobj2(uint256(), 1, 2000, uint256(), "");
+    BOOST_CHECK(govobj1.GetHash() != govobj2.GetHash());
+
+    for(int i = 0; i < 10; ++i) {
+        BOOST_CHECK(TestGovernanceManager::AddVoteReference(govman, ArithToUint256(arith_uint256(i + 1)), &govobj1));
+    }
+    BOOST_CHECK(!TestGovernanceManager::AddVoteReference(govman, ArithToUint256(arith_uint256(1)), &govobj1));
+    BOOST_CHECK(TestGovernanceManager::GetObjectVoteHashCount(govman, govobj1) == 10);
+
+    // past the cap the oldest references are pruned from the cache and from the set of their object
+    for(int i = 0; i < 4; ++i) {
+        TestGovernanceManager::AddVoteReference(govman, ArithToUint256(arith_uint256(i + 101)), &govobj2);
+    }
+    BOOST_CHECK(TestGovernanceManager::GetVoteCacheSize(govman) == 10);
+    BOOST_CHECK(TestGovernanceManager::GetObjectVoteHashCount(govman, govobj1) == 6);
+    BOOST_CHECK(TestGovernanceManager::GetObjectVoteHashCount(govman, govobj2) == 4);
+
+    // an object whose references were all pruned loses its set
+    for(int i = 4; i < 10; ++i) {
+        TestGovernanceManager::AddVoteReference(govman, ArithToUint256(arith_uint256(i + 101)), &govobj2);
+    }
+    BOOST_CHECK(TestGovernanceManager::GetVoteCacheSize(govman) == 10);
+    BOOST_CHECK(TestGovernanceManager::GetObjectVoteHashCount(govman, govobj1) == 0);
+    BOOST_CHECK(TestGovernanceManager::GetObjectVoteHashCount(govman, govobj2) == 10);
+    BOOST_CHECK(TestGovernanceManager::GetObjectCount(govman) == 1);
+
+    TestGovernanceManager::RemoveVoteReferences(govman, &govobj2);
+    BOOST_CHECK(TestGovernanceManager::GetVoteCacheSize(govman) == 0);
+    BOOST_CHECK(TestGovernanceManager::GetObjectCount(govman) == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,248 @@
+// Copyright (c) 2018 The Polis Core developers
+
+#include "governance-votedb.h"
+#include "arith_uint256.h"
+
+#include "test/test_polis.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_votedb_tests, BasicTestingSetup)
+
+class TestVoteFile
+{
+public:
+    // Check that every outpoint slot is in use and indexed
+    static bool CheckOutpoints(const CGovernanceObjectVoteFile& voteFile, size_t nExpected)
+    {
+        if(voteFile.vecOutpoints.size() != nExpected || voteFile.mapOutpointIndex.size() != nExpected) {
+            return false;
+        }
+        for(const auto& outpointpair : voteFile.mapOutpointIndex) {
+            if(voteFile.vecOutpoints[outpointpair.second] != outpointpair.first) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+static const uint256 hashParent = ArithToUint256(arith_uint256(1000));
+
+// A vote of masternode nMasternode with a signature of nSigSize bytes all
+// equal to nTime, so that every vote carries a recognizable signature
+CGovernanceVote CreateTestVote(int nMasternode, int64_t nTime, size_t nSigSize)
+{
+    CGovernanceVote vote(GetTestMasternodeOutpoint(nMasternode), hashParent, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+    vote.SetTime(nTime);
+    vote.SetSignature(std::vector<unsigned char>(nSigSize, (unsigned char)nTime));
+    return vote;
+}
+
+bool CompareVotes(const std::vector<CGovernanceVote>& vecVotes1, const std::vector<CGovernanceVote>& vecVotes2)
+{
+    if(vecVotes1.size() != vecVotes2.size()) {
+        return false;
+    }
+    for(size_t i = 0; i < vecVotes1.size(); ++i) {
+        if(vecVotes1[i].GetHash() != vecVotes2[i].GetHash() ||
+           vecVotes1[i].GetSignature() != vecVotes2[i].GetSignature() ||
+           vecVotes1[i].GetMasternodeOutpoint() != vecVotes2[i].GetMasternodeOutpoint() ||
+           vecVotes1[i].GetParentHash() != vecVotes2[i].GetParentHash()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(votedb_add_test)
+{
+    CGovernanceObjectVoteFile voteFile;
+
+    CGovernanceVote vote = CreateTestVote(0, 1, 65);
+    voteFile.AddVote(vote);
+    BOOST_CHECK(voteFile.GetVoteCount() == 1);
+    BOOST_CHECK(voteFile.HasVote(vote.GetHash()));
+
+    // a known vote is not added again
+    voteFile.AddVote(vote);
+    BOOST_CHECK(voteFile.GetVoteCount() == 1);
+    BOOST_CHECK(voteFile.GetVotes().size() == 1);
+
+    // the vote is rebuilt as it was added
+    std::vector<CGovernanceVote> vecVotes = voteFile.GetVotes();
+    BOOST_CHECK(CompareVotes(vecVotes, std::vector<CGovernanceVote>(1, vote)));
+    BOOST_CHECK(vecVotes[0].GetTimestamp() == 1);
+    BOOST_CHECK(vecVotes[0].GetSignal() == VOTE_SIGNAL_FUNDING);
+    BOOST_CHECK(vecVotes[0].GetOutcome() == VOTE_OUTCOME_YES);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(voteFile.SerializeVoteToStream(vote.GetHash(), ss));
+    CGovernanceVote voteRead;
+    ss >> voteRead;
+    BOOST_CHECK(voteRead.GetHash() == vote.GetHash());
+    BOOST_CHECK(!voteFile.SerializeVoteToStream(CreateTestVote(0, 2, 65).GetHash(), ss));
+}
+
+BOOST_AUTO_TEST_CASE(votedb_index_growth_test)
+{
+    CGovernanceObjectVoteFile voteFile;
+    std::vector<CGovernanceVote> vecAdded;
+
+    // grow the hash index several times, past 8, 16 and 32 votes
+    for(int i = 0; i < 40; ++i) {
+        vecAdded.push_back(CreateTestVote(i % 5, i + 1, 65 + i % 7));
+        voteFile.AddVote(vecAdded.back());
+        for(const auto& vote : vecAdded) {
+            BOOST_CHECK(voteFile.HasVote(vote.GetHash()));
+        }
+    }
+    BOOST_CHECK(voteFile.GetVoteCount() == 40);
+    BOOST_CHECK(!voteFile.HasVote(CreateTestVote(0, 100, 65).GetHash()));
+
+    // newest first
+    std::vector<CGovernanceVote> vecExpected(vecAdded.rbegin(), vecAdded.rend());
+    BOOST_CHECK(CompareVotes(voteFile.GetVotes(), vecExpected));
+
+    std::vector<uint256> vecHashes = voteFile.GetVoteHashes();
+    BOOST_CHECK(vecHashes.size() == 40);
+    BOOST_CHECK(vecHashes.front() == vecAdded.back().GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(votedb_remove_test)
+{
+    CGovernanceObjectVoteFile voteFile;
+    std::vector<CGovernanceVote> vecAdded;
+
+    // three masternodes with signatures of different sizes, interleaved
+    for(int i = 0; i < 30; ++i) {
+        vecAdded.push_back(CreateTestVote(i % 3, i + 1, 60 + 5 * (i % 3) + i % 2));
+        voteFile.AddVote(vecAdded.back());
+    }
+
+    COutPoint outpointRemoved = vecAdded[1].GetMasternodeOutpoint();
+    voteFile.RemoveVotesFromMasternode(outpointRemoved);
+    BOOST_CHECK(voteFile.GetVoteCount() == 20);
+
+    std::vector<CGovernanceVote> vecExpected;
+    for(std::vector<CGovernanceVote>::const_reverse_iterator it = vecAdded.rbegin(); it != vecAdded.rend(); ++it) {
+        bool fRemoved = it->GetMasternodeOutpoint() == outpointRemoved;
+        BOOST_CHECK(voteFile.HasVote(it->GetHash()) == !fRemoved);
+        if(!fRemoved) {
+            vecExpected.push_back(*it);
+        }
+    }
+
+    // signatures are still found in the compacted arena
+    BOOST_CHECK(CompareVotes(voteFile.GetVotes(), vecExpected));
+
+    // removing an unknown masternode changes nothing
+    voteFile.RemoveVotesFromMasternode(outpointRemoved);
+    BOOST_CHECK(voteFile.GetVoteCount() == 20);
+
+    // walk the votes in chunks
+    std::vector<CGovernanceVote> vecChunks;
+    uint256 nLastHash;
+    while(true) {
+        std::vector<CGovernanceVote> vecChunk;
+        BOOST_CHECK(voteFile.GetVotesAfter(nLastHash, 7, vecChunk));
+        if(vecChunk.empty()) {
+            break;
+        }
+        for(const auto& vote : vecChunk) {
+            vecChunks.push_back(vote);
+        }
+        nLastHash = vecChunk.back().GetHash();
+    }
+    BOOST_CHECK(CompareVotes(vecChunks, vecExpected));
+
+    // a cursor on a removed vote can't be resumed
+    std::vector<CGovernanceVote> vecRemoved;
+    BOOST_CHECK(!voteFile.GetVotesAfter(vecAdded[1].GetHash(), 3, vecRemoved));
+    BOOST_CHECK(vecRemoved.empty());
+
+    // votes added after the compaction are indexed and stored after the remaining ones
+    CGovernanceVote voteNew = CreateTestVote(1, 100, 70);
+    voteFile.AddVote(voteNew);
+    BOOST_CHECK(voteFile.HasVote(voteNew.GetHash()));
+    std::vector<CGovernanceVote> vecExpectedNew(1, voteNew);
+    for(const auto& vote : vecExpected) {
+        vecExpectedNew.push_back(vote);
+    }
+    BOOST_CHECK(CompareVotes(voteFile.GetVotes(), vecExpectedNew));
+}
+
+BOOST_AUTO_TEST_CASE(votedb_remove_reuse_test)
+{
+    CGovernanceObjectVoteFile voteFile;
+    std::vector<CGovernanceVote> vecAdded;
+    for(int i = 0; i < 20; ++i) {
+        vecAdded.push_back(CreateTestVote(i % 4, i + 1, 65));
+        voteFile.AddVote(vecAdded.back());
+    }
+    BOOST_CHECK(TestVoteFile::CheckOutpoints(voteFile, 4));
+
+    // the slot of a removed masternode is taken by the last one
+    voteFile.RemoveVotesFromMasternode(GetTestMasternodeOutpoint(1));
+    BOOST_CHECK(TestVoteFile::CheckOutpoints(voteFile, 3));
+    // removing the last slot leaves nothing to move
+    voteFile.RemoveVotesFromMasternode(GetTestMasternodeOutpoint(2));
+    BOOST_CHECK(TestVoteFile::CheckOutpoints(voteFile, 2));
+
+    // the moved votes still carry their own masternode
+    std::vector<CGovernanceVote> vecExpected;
+    for(std::vector<CGovernanceVote>::const_reverse_iterator it = vecAdded.rbegin(); it != vecAdded.rend(); ++it) {
+        if(it->GetMasternodeOutpoint() != GetTestMasternodeOutpoint(1) &&
+           it->GetMasternodeOutpoint() != GetTestMasternodeOutpoint(2)) {
+            vecExpected.push_back(*it);
+        }
+    }
+    BOOST_CHECK(CompareVotes(voteFile.GetVotes(), vecExpected));
+
+    // a masternode voting again gets a slot at the end
+    CGovernanceVote voteNew = CreateTestVote(1, 100, 65);
+    voteFile.AddVote(voteNew);
+    BOOST_CHECK(TestVoteFile::CheckOutpoints(voteFile, 3));
+    std::vector<CGovernanceVote> vecExpectedNew(1, voteNew);
+    for(const auto& vote : vecExpected) {
+        vecExpectedNew.push_back(vote);
+    }
+    BOOST_CHECK(CompareVotes(voteFile.GetVotes(), vecExpectedNew));
+
+    voteFile.RemoveVotesFromMasternode(GetTestMasternodeOutpoint(0));
+    voteFile.RemoveVotesFromMasternode(GetTestMasternodeOutpoint(3));
+    voteFile.RemoveVotesFromMasternode(GetTestMasternodeOutpoint(1));
+    BOOST_CHECK(TestVoteFile::CheckOutpoints(voteFile, 0));
+    BOOST_CHECK(voteFile.GetVoteCount() == 0);
+    BOOST_CHECK(voteFile.GetVotes().empty());
+}
+
+BOOST_AUTO_TEST_CASE(votedb_serialize_test)
+{
+    CGovernanceObjectVoteFile voteFile;
+    for(int i = 0; i < 20; ++i) {
+        voteFile.AddVote(CreateTestVote(i % 4, i + 1, 65 + i % 3));
+    }
+    voteFile.RemoveVotesFromMasternode(GetTestMasternodeOutpoint(1));
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << voteFile;
+
+    // the stored list is newest first
+    CDataStream ssCopy(ss);
+    int nMemoryVotes;
+    std::vector<CGovernanceVote> vecStored;
+    ssCopy >> nMemoryVotes >> vecStored;
+    BOOST_CHECK(nMemoryVotes == voteFile.GetVoteCount());
+    BOOST_CHECK(CompareVotes(vecStored, voteFile.GetVotes()));
+
+    CGovernanceObjectVoteFile voteFile2;
+    ss >> voteFile2;
+    BOOST_CHECK(voteFile2.GetVoteCount() == voteFile.GetVoteCount());
+    BOOST_CHECK(CompareVotes(voteFile2.GetVotes(), voteFile.GetVotes()));
+    for(const auto& vote : voteFile.GetVotes()) {
+        BOOST_CHECK(voteFile2.HasVote(vote.GetHash()));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
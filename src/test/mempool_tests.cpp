@@ -428,6 +428,53 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     CheckSort<ancestor_score>(pool, sortedOrder);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolFreeHeightTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    entry.nHeight = 100;
+
+    // Already over the free threshold when entering the pool
+    CMutableTransaction tx1 = CMutableTransaction();
+    tx1.vin.resize(1);
+    tx1.vin[0].scriptSig = CScript() << OP_1;
+    tx1.vout.resize(1);
+    tx1.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    tx1.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(tx1.GetHash(), entry.Priority(AllowFreeThreshold() * 2).FromTx(tx1));
+    BOOST_CHECK_EQUAL(pool.mapTx.find(tx1.GetHash())->GetFreeHeight(), 100);
+
+    // Gets there as its inputs age
+    CMutableTransaction tx2 = CMutableTransaction();
+    tx2.vin.resize(1);
+    tx2.vin[0].scriptSig = CScript() << OP_2;
+    tx2.vout.resize(1);
+    tx2.vout[0].scriptPubKey = CScript() << OP_2 << OP_EQUAL;
+    tx2.vout[0].nValue = 1 * COIN;
+    pool.addUnchecked(tx2.GetHash(), entry.Priority(0).FromTx(tx2));
+    CTxMemPool::txiter it2 = pool.mapTx.find(tx2.GetHash());
+    unsigned int nFreeHeight = it2->GetFreeHeight();
+    BOOST_CHECK(nFreeHeight > 100);
+    BOOST_CHECK(!AllowFree(it2->GetPriority(nFreeHeight - 1)));
+    BOOST_CHECK(AllowFree(it2->GetPriority(nFreeHeight + 1)));
+
+    // Never, without in-chain inputs
+    CMutableTransaction tx3 = CMutableTransaction();
+    tx3.vin.resize(1);
+    tx3.vin[0].scriptSig = CScript() << OP_3;
+    tx3.vout.resize(1);
+    tx3.vout[0].scriptPubKey = CScript() << OP_3 << OP_EQUAL;
+    tx3.vout[0].nValue = 0;
+    pool.addUnchecked(tx3.GetHash(), entry.FromTx(tx3));
+    BOOST_CHECK_EQUAL(pool.mapTx.find(tx3.GetHash())->GetFreeHeight(), std::numeric_limits<unsigned int>::max());
+
+    // Unless prioritised
+    pool.PrioritiseTransaction(tx3.GetHash(), tx3.GetHash().ToString(), AllowFreeThreshold() * 2, 0);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(tx3.GetHash())->GetFreeHeight(), 100);
+
+    // The one still waiting sorts last
+    BOOST_CHECK(pool.mapTx.get<free_height>().rbegin()->GetTx().GetHash() == tx2.GetHash());
+}
 
 BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
 {
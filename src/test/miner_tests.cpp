@@ -186,6 +186,40 @@ void TestPackageSelection(const CChainParams& chainparams, CScript scriptPubKey,
     mempool.addUnchecked(tx.GetHash(), entry.Fee(10000).FromTx(tx));
     pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(nullptr, chainparams, scriptPubKey, false);
     BOOST_CHECK(pblocktemplate->block.vtx[8]->GetHash() == hashLowFeeTx2);
+    mempool.clear();
+
+    // Test that a template on the same tip picks up new transactions on top
+    // of the previous selection, the same way a full rebuild would.
+    tx.vin[0].prevout.hash = txFirst[3]->GetHash();
+    tx.vin[0].prevout.n = 0;
+    tx.vout[0].nValue = 5000000000LL - 50000;
+    uint256 hashCachedTx = tx.GetHash();
+    mempool.addUnchecked(hashCachedTx, entry.Fee(50000).Time(GetTime()).SpendsCoinbase(true).FromTx(tx));
+    pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(nullptr, chainparams, scriptPubKey, false);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 2);
+
+    // Lower feerate child, appended to the cached selection
+    tx.vin[0].prevout.hash = hashCachedTx;
+    tx.vout[0].nValue -= 10000;
+    uint256 hashAppendedTx = tx.GetHash();
+    mempool.addUnchecked(hashAppendedTx, entry.Fee(10000).Time(GetTime()).SpendsCoinbase(false).FromTx(tx));
+    pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(nullptr, chainparams, scriptPubKey, false);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 3);
+    BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == hashCachedTx);
+    BOOST_CHECK(pblocktemplate->block.vtx[2]->GetHash() == hashAppendedTx);
+
+    blockTemplateCache.Clear();
+    std::unique_ptr<CBlockTemplate> pblocktemplateRebuilt = BlockAssembler(chainparams).CreateNewBlock(nullptr, chainparams, scriptPubKey, false);
+    BOOST_CHECK_EQUAL(pblocktemplateRebuilt->block.vtx.size(), pblocktemplate->block.vtx.size());
+    for (size_t i = 1; i < pblocktemplate->block.vtx.size(); ++i)
+        BOOST_CHECK(pblocktemplateRebuilt->block.vtx[i]->GetHash() == pblocktemplate->block.vtx[i]->GetHash());
+
+    // Removing a selected transaction invalidates the selection
+    mempool.removeRecursive(tx);
+    pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(nullptr, chainparams, scriptPubKey, false);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 2);
+    BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == hashCachedTx);
+    mempool.clear();
 }
 
 // NOTE: These tests rely on CreateNewBlock doing its own self-validation!
@@ -4,6 +4,7 @@
 
 #include "rpc/server.h"
 #include "rpc/client.h"
+#include "rpc/jsonwriter.h"
 
 #include "base58.h"
 #include "netbase.h"
@@ -343,6 +344,33 @@ BOOST_AUTO_TEST_CASE(rpc_convert_values_generatetoaddress)
     BOOST_CHECK_EQUAL(result[2].get_int(), 9);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_jsonwriter)
+{
+    UniValue value;
+    BOOST_CHECK(value.read("{\"a\":[1,-2.5,true,false,null,\"x\\\"\\\\\\n\\u0001\\u007f\"],\"b\":{},\"c\":[],\"d\":{\"e\":[[],{}]}}"));
+    CJSONWriter writer;
+    writer.Value(value);
+    BOOST_CHECK_EQUAL(writer.GetString(), value.write());
+
+    CJSONWriter writer2;
+    writer2.BeginArray();
+    writer2.Int(-3);
+    writer2.BeginObject();
+    writer2.Key("k");
+    writer2.String("v");
+    writer2.Key("n");
+    writer2.Value(value["b"]);
+    writer2.EndObject();
+    writer2.Bool(true);
+    writer2.EndArray();
+    BOOST_CHECK_EQUAL(writer2.GetString(), "[-3,{\"k\":\"v\",\"n\":{}},true]");
+
+    UniValue id(7);
+    BOOST_CHECK_EQUAL(JSONRPCReply(value, NullUniValue, id), JSONRPCReplyObj(value, NullUniValue, id).write() + "\n");
+    UniValue error = JSONRPCError(RPC_MISC_ERROR, "e");
+    BOOST_CHECK_EQUAL(JSONRPCReply(value, error, id), JSONRPCReplyObj(value, error, id).write() + "\n");
+}
+
 BOOST_AUTO_TEST_CASE(rpc_sentinel_ping)
 {
     BOOST_CHECK_NO_THROW(CallRPC("sentinelping 1.0.2"));
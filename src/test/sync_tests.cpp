@@ -0,0 +1,64 @@
+// Copyright (c) 2018 The Polis Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sync.h"
+#include "test/test_polis.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(sync_tests, BasicTestingSetup)
+
+static const CLockSiteSnapshot* FindLockSite(const std::vector<CLockSiteSnapshot>& vStats, const std::string& strName)
+{
+    for (size_t i = 0; i < vStats.size(); i++)
+        if (vStats[i].strName == strName)
+            return &vStats[i];
+    return NULL;
+}
+
+BOOST_AUTO_TEST_CASE(lockstats)
+{
+    CCriticalSection csStats;
+
+    ResetLockStats();
+    fLockStats = false;
+    {
+        LOCK(csStats);
+    }
+    BOOST_CHECK(FindLockSite(GetLockStats(), "csStats") == NULL);
+
+    fLockStats = true;
+    for (int i = 0; i < 3; i++) {
+        LOCK(csStats);
+        {
+            TRY_LOCK(csStats, lockStats);
+            bool fLocked = lockStats;
+            BOOST_CHECK(fLocked);
+        }
+    }
+    fLockStats = false;
+
+    std::vector<CLockSiteSnapshot> vStats = GetLockStats();
+    const CLockSiteSnapshot* stats = FindLockSite(vStats, "csStats");
+    BOOST_REQUIRE(stats != NULL);
+    BOOST_CHECK_EQUAL(stats->nAcquired, 3U);
+    BOOST_CHECK_EQUAL(stats->nContended, 0U);
+    BOOST_CHECK_EQUAL(stats->vWaitHistogram.size(), (size_t)LOCKSTATS_BUCKETS);
+    uint64_t nHeld = 0;
+    for (size_t i = 0; i < stats->vHoldHistogram.size(); i++)
+        nHeld += stats->vHoldHistogram[i];
+    BOOST_CHECK_EQUAL(nHeld, 3U);
+
+    // The LOCK and the TRY_LOCK are separate sites
+    size_t nSites = 0;
+    for (size_t i = 0; i < vStats.size(); i++)
+        if (vStats[i].strName == "csStats")
+            nSites++;
+    BOOST_CHECK_EQUAL(nSites, 2U);
+
+    ResetLockStats();
+    BOOST_CHECK(FindLockSite(GetLockStats(), "csStats") == NULL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,7 @@
 
 #include "test_polis.h"
 
+#include "arith_uint256.h"
 #include "chainparams.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
@@ -150,6 +151,11 @@ CTxMemPoolEntry TestMemPoolEntryHelper::FromTx(const CTransaction &txn, CTxMemPo
                            txn.GetValueOut(), spendsCoinbase, sigOpCount, lp);
 }
 
+COutPoint GetTestMasternodeOutpoint(int n)
+{
+    return COutPoint(ArithToUint256(arith_uint256(n + 1)), 0);
+}
+
 void Shutdown(void* parg)
 {
   exit(0);
@@ -90,4 +90,8 @@ struct TestMemPoolEntryHelper
     TestMemPoolEntryHelper &SpendsCoinbase(bool _flag) { spendsCoinbase = _flag; return *this; }
     TestMemPoolEntryHelper &SigOps(unsigned int _sigops) { sigOpCount = _sigops; return *this; }
 };
+
+/** Collateral outpoint of test masternode n, a different one for every n */
+COutPoint GetTestMasternodeOutpoint(int n);
+
 #endif
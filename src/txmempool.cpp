@@ -40,6 +40,8 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
     assert(inChainInputValue <= nValueIn);
 
     feeDelta = 0;
+    priorityDelta = 0;
+    UpdateFreeHeight();
 
     nCountWithAncestors = 1;
     nSizeWithAncestors = nTxSize;
@@ -69,6 +71,30 @@ void CTxMemPoolEntry::UpdateFeeDelta(int64_t newFeeDelta)
     feeDelta = newFeeDelta;
 }
 
+void CTxMemPoolEntry::UpdatePriorityDelta(double newPriorityDelta)
+{
+    priorityDelta = newPriorityDelta;
+    UpdateFreeHeight();
+}
+
+void CTxMemPoolEntry::UpdateFreeHeight()
+{
+    // The priority grows linearly with the height, so the height at which it
+    // gets over the threshold is known when the transaction enters the pool.
+    double dMissing = AllowFreeThreshold() - entryPriority - priorityDelta;
+    if (dMissing <= 0) {
+        nFreeHeight = entryHeight;
+    } else if (inChainInputValue <= 0) {
+        nFreeHeight = std::numeric_limits<unsigned int>::max();
+    } else {
+        double dHeights = dMissing * nModSize / inChainInputValue;
+        if (dHeights >= std::numeric_limits<unsigned int>::max() - entryHeight)
+            nFreeHeight = std::numeric_limits<unsigned int>::max();
+        else
+            nFreeHeight = entryHeight + (unsigned int)dHeights;
+    }
+}
+
 void CTxMemPoolEntry::UpdateLockPoints(const LockPoints& lp)
 {
     lockPoints = lp;
@@ -401,6 +427,9 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
         if (deltas.second) {
             mapTx.modify(newit, update_fee_delta(deltas.second));
         }
+        if (deltas.first) {
+            mapTx.modify(newit, update_priority_delta(deltas.first));
+        }
     }
 
     // Update cachedInnerUsage to include contained transaction's usage.
@@ -1078,6 +1107,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256 hash, const std::string str
         txiter it = mapTx.find(hash);
         if (it != mapTx.end()) {
             mapTx.modify(it, update_fee_delta(deltas.second));
+            mapTx.modify(it, update_priority_delta(deltas.first));
             // Now update all ancestors' modified fees with descendants
             setEntries setAncestors;
             uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
@@ -1145,7 +1175,7 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 18 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
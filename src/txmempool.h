@@ -97,6 +97,8 @@ private:
     bool spendsCoinbase;       //!< keep track of transactions that spend a coinbase
     unsigned int sigOpCount;   //!< Legacy sig ops plus P2SH sig op count
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
+    double priorityDelta;      //!< Priority delta from prioritisetransaction, only used for nFreeHeight
+    unsigned int nFreeHeight;  //!< Height from which the priority may be over AllowFreeThreshold()
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
 
     // Information about descendants of this transaction that are in the
@@ -133,8 +135,15 @@ public:
     size_t GetTxSize() const { return nTxSize; }
     int64_t GetTime() const { return nTime; }
     unsigned int GetHeight() const { return entryHeight; }
+    CAmount GetInChainInputValue() const { return inChainInputValue; }
     unsigned int GetSigOpCount() const { return sigOpCount; }
     int64_t GetModifiedFee() const { return nFee + feeDelta; }
+    /**
+     * Height from which GetPriority() plus the priority delta may be over
+     * AllowFreeThreshold(). Rounded down, so the priority still has to be
+     * checked at that height.
+     */
+    unsigned int GetFreeHeight() const { return nFreeHeight; }
     size_t DynamicMemoryUsage() const { return nUsageSize; }
     const LockPoints& GetLockPoints() const { return lockPoints; }
 
@@ -145,6 +154,9 @@ public:
     // Updates the fee delta used for mining priority score, and the
     // modified fees with descendants.
     void UpdateFeeDelta(int64_t feeDelta);
+    // Updates the priority delta, and the height from which the transaction
+    // may be mined for free.
+    void UpdatePriorityDelta(double priorityDelta);
     // Update the LockPoints after a reorg
     void UpdateLockPoints(const LockPoints& lp);
 
@@ -160,6 +172,9 @@ public:
     unsigned int GetSigOpCountWithAncestors() const { return nSigOpCountWithAncestors; }
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+
+private:
+    void UpdateFreeHeight();
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -204,6 +219,16 @@ private:
     int64_t feeDelta;
 };
 
+struct update_priority_delta
+{
+    update_priority_delta(double _priorityDelta) : priorityDelta(_priorityDelta) { }
+
+    void operator() (CTxMemPoolEntry &e) { e.UpdatePriorityDelta(priorityDelta); }
+
+private:
+    double priorityDelta;
+};
+
 struct update_lock_points
 {
     update_lock_points(const LockPoints& _lp) : lp(_lp) { }
@@ -311,11 +336,21 @@ public:
     }
 };
 
+class CompareTxMemPoolEntryByFreeHeight
+{
+public:
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
+    {
+        return a.GetFreeHeight() < b.GetFreeHeight();
+    }
+};
+
 // Multi_index tag names
 struct descendant_score {};
 struct entry_time {};
 struct mining_score {};
 struct ancestor_score {};
+struct free_height {};
 
 class CBlockPolicyEstimator;
 
@@ -492,6 +527,12 @@ public:
                 boost::multi_index::tag<ancestor_score>,
                 boost::multi_index::identity<CTxMemPoolEntry>,
                 CompareTxMemPoolEntryByAncestorFee
+            >,
+            // sorted by height from which the priority allows free inclusion
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::tag<free_height>,
+                boost::multi_index::identity<CTxMemPoolEntry>,
+                CompareTxMemPoolEntryByFreeHeight
             >
         >
     > indexed_transaction_set;
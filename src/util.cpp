@@ -79,6 +79,8 @@
 #include <malloc.h>
 #endif
 
+#include <deque>
+
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/predicate.hpp> // for startswith() and endswith()
@@ -135,6 +137,7 @@ bool fLogTimestamps = DEFAULT_LOGTIMESTAMPS;
 bool fLogTimeMicros = DEFAULT_LOGTIMEMICROS;
 bool fLogThreadNames = DEFAULT_LOGTHREADNAMES;
 bool fLogIPs = DEFAULT_LOGIPS;
+int64_t nLogRateLimit = DEFAULT_LOGRATELIMIT;
 std::atomic<bool> fReopenDebugLog(false);
 CTranslationInterface translationInterface;
 
@@ -215,6 +218,31 @@ static FILE* fileout = NULL;
 static boost::mutex* mutexDebugLog = NULL;
 static std::list<std::string>* vMsgsBeforeOpenLog;
 
+/**
+ * While the writer thread runs, messages are queued for it rather than
+ * written to fileout on the logging thread, and only it touches fileout.
+ * Guarded by mutexDebugLog.
+ */
+static std::deque<std::string>* vMsgsToWrite = NULL;
+static boost::condition_variable* condDebugLogWriter = NULL;
+static boost::condition_variable* condDebugLogQueue = NULL;
+static boost::thread* threadDebugLogWriter = NULL;
+static bool fStopDebugLogWriter = false;
+/** Loggers wait for the writer rather than queue more than this */
+static const size_t MAX_DEBUG_LOG_QUEUE = 10000;
+
+/** Per category message counts for -debugratelimit, guarded by mutexLogRate */
+struct CLogRate
+{
+    int64_t nSecond;
+    int64_t nCount;
+    int64_t nSuppressed;
+
+    CLogRate() : nSecond(0), nCount(0), nSuppressed(0) {}
+};
+static boost::mutex* mutexLogRate = NULL;
+static std::map<std::string, CLogRate>* mapLogRate = NULL;
+
 static int FileWriteStr(const std::string &str, FILE *fp)
 {
     return fwrite(str.data(), 1, str.size(), fp);
@@ -225,6 +253,90 @@ static void DebugPrintInit()
     assert(mutexDebugLog == NULL);
     mutexDebugLog = new boost::mutex();
     vMsgsBeforeOpenLog = new std::list<std::string>;
+    vMsgsToWrite = new std::deque<std::string>;
+    condDebugLogWriter = new boost::condition_variable();
+    condDebugLogQueue = new boost::condition_variable();
+    mutexLogRate = new boost::mutex();
+    mapLogRate = new std::map<std::string, CLogRate>;
+}
+
+/** Reopen debug.log if requested. Called by whoever is writing to fileout. */
+static void ReopenDebugLogIfRequested()
+{
+    if (fReopenDebugLog) {
+        fReopenDebugLog = false;
+        boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
+        if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
+            setbuf(fileout, NULL); // unbuffered
+    }
+}
+
+static void ThreadDebugLogWriter()
+{
+    RenameThread("polis-logwriter");
+    boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+    while (true) {
+        while (vMsgsToWrite->empty() && !fStopDebugLogWriter)
+            condDebugLogWriter->wait(scoped_lock);
+        if (vMsgsToWrite->empty())
+            break;
+
+        // Write everything queued in one go, without holding up the loggers
+        std::string strWrite;
+        while (!vMsgsToWrite->empty()) {
+            strWrite += vMsgsToWrite->front();
+            vMsgsToWrite->pop_front();
+        }
+        condDebugLogQueue->notify_all();
+        scoped_lock.unlock();
+        ReopenDebugLogIfRequested();
+        FileWriteStr(strWrite, fileout);
+        scoped_lock.lock();
+    }
+    // From here on loggers write fileout themselves again
+    threadDebugLogWriter = NULL;
+    condDebugLogQueue->notify_all();
+}
+
+void StopDebugLogWriter()
+{
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+    boost::thread* thread;
+    {
+        boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+        if (threadDebugLogWriter == NULL)
+            return;
+        thread = threadDebugLogWriter;
+        fStopDebugLogWriter = true;
+        condDebugLogWriter->notify_all();
+    }
+    thread->join();
+    delete thread;
+}
+
+/** Whether a LogPrint of category is within -debugratelimit */
+static bool LogRateAccept(const char* category)
+{
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+    int64_t nNow = GetTime();
+    int64_t nSuppressed = 0;
+    {
+        boost::mutex::scoped_lock scoped_lock(*mutexLogRate);
+        CLogRate& rate = (*mapLogRate)[category];
+        if (rate.nSecond != nNow) {
+            nSuppressed = rate.nSuppressed;
+            rate.nSecond = nNow;
+            rate.nCount = 0;
+            rate.nSuppressed = 0;
+        }
+        if (++rate.nCount > nLogRateLimit) {
+            ++rate.nSuppressed;
+            return false;
+        }
+    }
+    if (nSuppressed > 0)
+        LogPrintf("%d debug messages of category %s suppressed by -debugratelimit\n", nSuppressed, category);
+    return true;
 }
 
 void OpenDebugLog()
@@ -243,6 +355,10 @@ void OpenDebugLog()
             FileWriteStr(vMsgsBeforeOpenLog->front(), fileout);
             vMsgsBeforeOpenLog->pop_front();
         }
+        if (GetBoolArg("-logasync", DEFAULT_LOGASYNC)) {
+            fStopDebugLogWriter = false;
+            threadDebugLogWriter = new boost::thread(&ThreadDebugLogWriter);
+        }
     }
 
     delete vMsgsBeforeOpenLog;
@@ -258,11 +374,16 @@ bool LogAcceptCategory(const char* category)
         // where mapMultiArgs might be deleted before another
         // global destructor calls LogPrint()
         static boost::thread_specific_ptr<std::set<std::string> > ptrCategory;
+        // Answers so far, by the address of the category name. LogPrint is
+        // called with string literals, so this saves building std::strings
+        // and set lookups on every call.
+        static boost::thread_specific_ptr<std::map<const char*, bool> > ptrAccepted;
 
         if (!fDebug) {
             if (ptrCategory.get() != NULL) {
                 LogPrintf("debug turned off: thread %s\n", GetThreadName());
                 ptrCategory.release();
+                ptrAccepted.reset();
             }
             return false;
         }
@@ -290,13 +411,23 @@ bool LogAcceptCategory(const char* category)
             } else {
                 ptrCategory.reset(new std::set<std::string>());
             }
+            ptrAccepted.reset(new std::map<const char*, bool>());
+        }
+
+        std::map<const char*, bool>::const_iterator it = ptrAccepted->find(category);
+        if (it == ptrAccepted->end()) {
+            const std::set<std::string>& setCategories = *ptrCategory.get();
+
+            // if not debugging everything and not debugging specific category, LogPrint does nothing.
+            bool fAccept = setCategories.count(std::string("")) != 0 ||
+                           setCategories.count(std::string("1")) != 0 ||
+                           setCategories.count(std::string(category)) != 0;
+            it = ptrAccepted->insert(std::make_pair(category, fAccept)).first;
         }
-        const std::set<std::string>& setCategories = *ptrCategory.get();
+        if (!it->second)
+            return false;
 
-        // if not debugging everything and not debugging specific category, LogPrint does nothing.
-        if (setCategories.count(std::string("")) == 0 &&
-            setCategories.count(std::string("1")) == 0 &&
-            setCategories.count(std::string(category)) == 0)
+        if (nLogRateLimit > 0 && !LogRateAccept(category))
             return false;
     }
     return true;
@@ -378,15 +509,24 @@ int LogPrintStr(const std::string &str)
             ret = strTimestamped.length();
             vMsgsBeforeOpenLog->push_back(strTimestamped);
         }
+        else if (threadDebugLogWriter != NULL)
+        {
+            // hand it to the writer thread, unless it is too far behind
+            while (vMsgsToWrite->size() >= MAX_DEBUG_LOG_QUEUE && threadDebugLogWriter != NULL)
+                condDebugLogQueue->wait(scoped_lock);
+            if (threadDebugLogWriter != NULL) {
+                ret = strTimestamped.length();
+                vMsgsToWrite->push_back(strTimestamped);
+                condDebugLogWriter->notify_one();
+            } else {
+                ReopenDebugLogIfRequested();
+                ret = FileWriteStr(strTimestamped, fileout);
+            }
+        }
         else
         {
             // reopen the log file, if requested
-            if (fReopenDebugLog) {
-                fReopenDebugLog = false;
-                boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
-                if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
-                    setbuf(fileout, NULL); // unbuffered
-            }
+            ReopenDebugLogIfRequested();
 
             ret = FileWriteStr(strTimestamped, fileout);
         }
@@ -625,6 +625,8 @@ static bool IsCurrentForFeeEstimation()
     return true;
 }
 
+static bool CheckInputScriptsParallel(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, unsigned int flags, bool cacheStore);
+
 bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx, bool fLimitFree,
                               bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
                               bool fOverrideMempoolLimit, const CAmount& nAbsurdFee,
@@ -1023,7 +1025,9 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        if (!CheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true))
+        // The input scripts are spread over the script check threads, as
+        // cs_main is held for as long as they take.
+        if (!CheckInputScriptsParallel(tx, state, view, STANDARD_SCRIPT_VERIFY_FLAGS, true))
             return false; // state filled in by CheckInputs
 
         // Check again against just the consensus-critical mandatory script
@@ -1165,7 +1169,9 @@ bool GetAddressUnspent(uint160 addressHash, int type,
 bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus::Params& consensusParams, uint256 &hashBlock, bool fAllowSlow)
 {
     CBlockIndex *pindexSlow = NULL;
-    LOCK(cs_main);
+    // Neither the mempool nor the transaction index need cs_main. A block's
+    // transactions are written to the index before they leave the mempool,
+    // so looking in that order cannot miss one being mined meanwhile.
     CTransactionRef ptx = mempool.get(hash);
     if (ptx)
     {
@@ -1195,6 +1201,7 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
         return false;
     }
 
+    LOCK(cs_main);
     if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
         const Coin& coin = AccessByTxid(*pcoinsTip, hash);
         if (!coin.IsSpent()) pindexSlow = chainActive[coin.nHeight];
@@ -1947,6 +1954,28 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+/**
+ * CheckInputs for a loose transaction, with the script checks of its inputs
+ * run on scriptcheckqueue. A failure is checked again serially, so that state
+ * tells apart non-mandatory flag failures just like CheckInputs does.
+ */
+static bool CheckInputScriptsParallel(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, unsigned int flags, bool cacheStore)
+{
+    if (!nScriptCheckThreads || tx.vin.size() < 2)
+        return CheckInputs(tx, state, inputs, true, flags, cacheStore);
+
+    std::vector<CScriptCheck> vChecks;
+    if (!CheckInputs(tx, state, inputs, true, flags, cacheStore, &vChecks))
+        return false;
+
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(vChecks);
+    if (control.Wait())
+        return true;
+
+    return CheckInputs(tx, state, inputs, true, flags, cacheStore);
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -4668,7 +4697,91 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
     return VersionBitsStateSinceHeight(chainActive.Tip(), params, pos, versionbitscache);
 }
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+/** mempool.dat with transactions only, every one has to be revalidated */
+static const uint64_t MEMPOOL_DUMP_VERSION_TXONLY = 1;
+/** mempool.dat with the tip it was dumped at and each entry's metadata */
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+/** Transactions from mempool.dat verified together on the script check threads */
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 1000;
+
+/**
+ * Put an entry from mempool.dat back into the pool without validating it
+ * again, which is fine as long as the tip didn't change since it was dumped.
+ * Returns false if its inputs aren't there as expected, in which case it has
+ * to go through AcceptToMemoryPool.
+ */
+static bool RestoreMempoolEntry(CTxMemPool& pool, const CTxMemPoolEntry& entry)
+{
+    AssertLockHeld(cs_main);
+    LOCK(pool.cs);
+    const CTransaction& tx = entry.GetTx();
+    if (pool.exists(tx.GetHash()))
+        return false;
+    BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+        if (pool.mapNextTx.count(txin.prevout))
+            return false;
+        CTransactionRef ptxParent = pool.get(txin.prevout.hash);
+        if (ptxParent) {
+            if (txin.prevout.n >= ptxParent->vout.size())
+                return false;
+        } else if (!pcoinsTip->HaveCoin(txin.prevout)) {
+            return false;
+        }
+    }
+
+    CTxMemPool::setEntries setAncestors;
+    uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    std::string dummy;
+    pool.CalculateMemPoolAncestors(entry, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy);
+    pool.addUnchecked(tx.GetHash(), entry, setAncestors, false);
+    return true;
+}
+
+/**
+ * Run a batch of transactions from mempool.dat through AcceptToMemoryPool.
+ * Their input scripts are verified on the script check threads first, without
+ * cs_main, so that the serial acceptance mostly finds the signatures cached.
+ */
+static void AcceptMempoolBatch(const std::vector<std::pair<CTransactionRef, int64_t> >& vBatch, int64_t& count, int64_t& failed)
+{
+    if (nScriptCheckThreads) {
+        std::vector<CScriptCheck> vChecks;
+        {
+            LOCK2(cs_main, mempool.cs);
+            CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
+            for (const auto& i : vBatch) {
+                const CTransaction& tx = *i.first;
+                std::vector<Coin> vCoins(tx.vin.size());
+                bool fHaveInputs = true;
+                for (unsigned int j = 0; j < tx.vin.size() && fHaveInputs; j++)
+                    fHaveInputs = viewMemPool.GetCoin(tx.vin[j].prevout, vCoins[j]);
+                // Spends another transaction of this batch, left to AcceptToMemoryPool
+                if (!fHaveInputs)
+                    continue;
+                for (unsigned int j = 0; j < tx.vin.size(); j++) {
+                    CScriptCheck check(vCoins[j].out.scriptPubKey, vCoins[j].out.nValue, tx, j, STANDARD_SCRIPT_VERIFY_FLAGS, true);
+                    vChecks.push_back(CScriptCheck());
+                    check.swap(vChecks.back());
+                }
+            }
+        }
+        // A failure only stops the warm-up, AcceptToMemoryPool has the last word
+        CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    for (const auto& i : vBatch) {
+        CValidationState state;
+        LOCK(cs_main);
+        AcceptToMemoryPoolWithTime(mempool, state, i.first, true, NULL, i.second);
+        if (state.IsValid()) {
+            ++count;
+        } else {
+            ++failed;
+        }
+    }
+}
 
 bool LoadMempool(void)
 {
@@ -4681,20 +4794,38 @@ bool LoadMempool(void)
     }
 
     int64_t count = 0;
+    int64_t restored = 0;
     int64_t skipped = 0;
     int64_t failed = 0;
     int64_t nNow = GetTime();
+    int64_t nStart = GetTimeMicros();
 
     try {
         uint64_t version;
         file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        if (version != MEMPOOL_DUMP_VERSION && version != MEMPOOL_DUMP_VERSION_TXONLY) {
             return false;
         }
+        // Entries are only trusted on the tip they were dumped at. The address
+        // and spent indexes need the coins of every input, so with those the
+        // transactions still go through AcceptToMemoryPool.
+        bool fRestore = false;
+        uint256 hashBestBlock;
+        if (version == MEMPOOL_DUMP_VERSION) {
+            file >> hashBestBlock;
+            LOCK(cs_main);
+            fRestore = !fAddressIndex && !fSpentIndex && chainActive.Tip() != NULL &&
+                       chainActive.Tip()->GetBlockHash() == hashBestBlock;
+        }
         uint64_t num;
         file >> num;
         double prioritydummy = 0;
+        std::vector<std::pair<CTransactionRef, int64_t> > vBatch;
         while (num--) {
+            // Checked first, restored and skipped entries continue early
+            if (ShutdownRequested())
+                return false;
+
             CTransactionRef tx;
             int64_t nTime;
             int64_t nFeeDelta;
@@ -4702,25 +4833,60 @@ bool LoadMempool(void)
             file >> nTime;
             file >> nFeeDelta;
 
+            int64_t nFee = 0;
+            double dPriority = 0;
+            unsigned int nHeight = 0;
+            int64_t nInChainInputValue = 0;
+            bool fSpendsCoinbase = false;
+            unsigned int nSigOps = 0;
+            LockPoints lp;
+            uint256 hashMaxInputBlock;
+            if (version == MEMPOOL_DUMP_VERSION) {
+                file >> nFee;
+                file >> dPriority;
+                file >> nHeight;
+                file >> nInChainInputValue;
+                file >> fSpendsCoinbase;
+                file >> nSigOps;
+                file >> lp.height;
+                file >> lp.time;
+                file >> hashMaxInputBlock;
+            }
+
             CAmount amountdelta = nFeeDelta;
             if (amountdelta) {
                 mempool.PrioritiseTransaction(tx->GetHash(), tx->GetHash().ToString(), prioritydummy, amountdelta);
             }
-            CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
+            if (nTime + nExpiryTimeout <= nNow) {
+                ++skipped;
+                continue;
+            }
+
+            if (fRestore) {
                 LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(mempool, state, tx, true, NULL, nTime);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    ++failed;
+                // Blocks may connect while loading, from then on the metadata
+                // is stale and the remaining entries have to be validated
+                fRestore = chainActive.Tip()->GetBlockHash() == hashBestBlock;
+                BlockMap::iterator mi = mapBlockIndex.find(hashMaxInputBlock);
+                if (fRestore && (hashMaxInputBlock.IsNull() || mi != mapBlockIndex.end())) {
+                    lp.maxInputBlock = hashMaxInputBlock.IsNull() ? NULL : mi->second;
+                    CTxMemPoolEntry entry(tx, nFee, nTime, dPriority, nHeight, nInChainInputValue, fSpendsCoinbase, nSigOps, lp);
+                    if (RestoreMempoolEntry(mempool, entry)) {
+                        GetMainSignals().SyncTransaction(*tx, NULL, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
+                        ++restored;
+                        continue;
+                    }
                 }
-            } else {
-                ++skipped;
             }
-            if (ShutdownRequested())
-                return false;
+
+            vBatch.push_back(std::make_pair(tx, nTime));
+            if (vBatch.size() >= MEMPOOL_LOAD_BATCH_SIZE) {
+                AcceptMempoolBatch(vBatch, count, failed);
+                vBatch.clear();
+            }
         }
+        AcceptMempoolBatch(vBatch, count, failed);
+
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
 
@@ -4732,7 +4898,16 @@ bool LoadMempool(void)
         return false;
     }
 
-    LogPrintf("Imported mempool transactions from disk: %i successes, %i failed, %i expired\n", count, failed, skipped);
+    if (restored) {
+        // Limits may have been lowered since the dump
+        LOCK(cs_main);
+        LimitMempoolSize(mempool, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, nExpiryTimeout);
+        CValidationState stateDummy;
+        FlushStateToDisk(stateDummy, FLUSH_STATE_PERIODIC);
+    }
+
+    LogPrintf("Imported mempool transactions from disk: %i restored, %i successes, %i failed, %i expired (%.2fs)\n",
+              restored, count, failed, skipped, (GetTimeMicros() - nStart) * 0.000001);
     return true;
 }
 
@@ -4741,14 +4916,21 @@ void DumpMempool(void)
     int64_t start = GetTimeMicros();
 
     std::map<uint256, CAmount> mapDeltas;
-    std::vector<TxMempoolInfo> vinfo;
+    std::vector<CTxMemPoolEntry> ventries;
+    uint256 hashBestBlock;
 
     {
-        LOCK(mempool.cs);
+        LOCK2(cs_main, mempool.cs);
+        if (chainActive.Tip() != NULL)
+            hashBestBlock = chainActive.Tip()->GetBlockHash();
         for (const auto &i : mempool.mapDeltas) {
             mapDeltas[i.first] = i.second.second;
         }
-        vinfo = mempool.infoAll();
+        // infoAll() has parents before children, which the restore relies on
+        ventries.reserve(mempool.size());
+        for (const auto& i : mempool.infoAll()) {
+            ventries.push_back(*mempool.mapTx.find(i.tx->GetHash()));
+        }
     }
 
     int64_t mid = GetTimeMicros();
@@ -4763,13 +4945,24 @@ void DumpMempool(void)
 
         uint64_t version = MEMPOOL_DUMP_VERSION;
         file << version;
-
-        file << (uint64_t)vinfo.size();
-        for (const auto& i : vinfo) {
-            file << *(i.tx);
-            file << (int64_t)i.nTime;
-            file << (int64_t)i.nFeeDelta;
-            mapDeltas.erase(i.tx->GetHash());
+        file << hashBestBlock;
+
+        file << (uint64_t)ventries.size();
+        for (const auto& e : ventries) {
+            const LockPoints& lp = e.GetLockPoints();
+            file << e.GetTx();
+            file << (int64_t)e.GetTime();
+            file << (int64_t)(e.GetModifiedFee() - e.GetFee());
+            file << (int64_t)e.GetFee();
+            file << e.GetPriority(e.GetHeight());
+            file << e.GetHeight();
+            file << (int64_t)e.GetInChainInputValue();
+            file << e.GetSpendsCoinbase();
+            file << e.GetSigOpCount();
+            file << lp.height;
+            file << lp.time;
+            file << (lp.maxInputBlock ? lp.maxInputBlock->GetBlockHash() : uint256());
+            mapDeltas.erase(e.GetTx().GetHash());
         }
 
         file << mapDeltas;
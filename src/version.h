@@ -11,7 +11,7 @@
  */
 
 
-static const int PROTOCOL_VERSION = 70217;
+static const int PROTOCOL_VERSION = 70218;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -44,4 +44,7 @@ static const int DIP0001_PROTOCOL_VERSION = 70208;
 //! short-id-based block download starts with this version
 static const int SHORT_IDS_BLOCKS_VERSION = 70209;
 
+//! cmpctblock messages carry the PoS block signature starting with this version
+static const int CMPCTBLOCK_BLOCKSIG_VERSION = 70218;
+
 #endif // BITCOIN_VERSION_H
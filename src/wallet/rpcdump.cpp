@@ -435,6 +435,9 @@ UniValue importwallet(const JSONRPCRequest& request)
 
     EnsureWalletIsUnlocked();
 
+    // Commit the imported keys, labels and rescan results together
+    CWalletDBBatch batch(*pwalletMain);
+
     std::ifstream file;
     file.open(request.params[0].get_str().c_str(), std::ios::in | std::ios::ate);
     if (!file.is_open())
@@ -540,6 +543,9 @@ UniValue importelectrumwallet(const JSONRPCRequest& request)
 
     EnsureWalletIsUnlocked();
 
+    // Commit the imported keys, labels and rescan results together
+    CWalletDBBatch batch(*pwalletMain);
+
     std::ifstream file;
     std::string strFileName = request.params[0].get_str();
     size_t nDotPos = strFileName.find_last_of(".");
@@ -1317,6 +1323,9 @@ UniValue importmulti(const JSONRPCRequest& mainRequest)
     LOCK2(cs_main, pwalletMain->cs_wallet);
     EnsureWalletIsUnlocked();
 
+    // Commit the imported keys, scripts and rescan results together
+    CWalletDBBatch batch(*pwalletMain);
+
     // Verify all timestamps are present before importing any keys.
     const int64_t now = chainActive.Tip() ? chainActive.Tip()->GetMedianTimePast() : 0;
     for (const UniValue& data : requests.getValues()) {
@@ -9,6 +9,7 @@
 #include <utility>
 #include <vector>
 
+#include "consensus/consensus.h"
 #include "rpc/server.h"
 #include "test/test_polis.h"
 #include "validation.h"
@@ -361,6 +362,32 @@ BOOST_AUTO_TEST_CASE(ApproximateBestSubset)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(keypool_topup_batched)
+{
+    LOCK(pwalletMain->cs_wallet);
+
+    // Keys and pool entries written in the batch are on disk once it ends
+    BOOST_CHECK(pwalletMain->TopUpKeyPool(5));
+    BOOST_CHECK_EQUAL(pwalletMain->GetKeyPoolSize(), 5U);
+    CKeyPool keypool;
+    for (int64_t nIndex = 1; nIndex <= 5; nIndex++) {
+        BOOST_CHECK(CWalletDB(pwalletMain->strWalletFile).ReadPool(nIndex, keypool));
+        BOOST_CHECK(pwalletMain->HaveKey(keypool.vchPubKey.GetID()));
+    }
+
+    // Nested batches share the outer transaction
+    {
+        CWalletDBBatch batch(*pwalletMain);
+        {
+            CWalletDBBatch batchInner(*pwalletMain);
+            BOOST_CHECK(pwalletMain->SetAddressBook(keypool.vchPubKey.GetID(), "batched", "receive"));
+        }
+        BOOST_CHECK(pwalletMain->TopUpKeyPool(6));
+    }
+    BOOST_CHECK_EQUAL(pwalletMain->GetKeyPoolSize(), 6U);
+    BOOST_CHECK(CWalletDB(pwalletMain->strWalletFile).ReadPool(6, keypool));
+}
+
 BOOST_FIXTURE_TEST_CASE(rescan, TestChain100Setup)
 {
     LOCK(cs_main);
@@ -428,6 +455,63 @@ BOOST_FIXTURE_TEST_CASE(rescan, TestChain100Setup)
     }
 }
 
+// Verify cached balance totals follow the chain tip without the wallet seeing
+// the new block, and agree with a full recalculation.
+BOOST_FIXTURE_TEST_CASE(balances_follow_tip, TestChain100Setup)
+{
+    LOCK(cs_main);
+
+    CWallet wallet;
+    LOCK(wallet.cs_wallet);
+    wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+    wallet.ScanForWalletTransactions(chainActive.Genesis());
+    CWalletBalances before = wallet.GetBalances();
+    BOOST_CHECK(before.nImmature > 0);
+
+    // The new block doesn't pay us, but matures one of our coinbases
+    CKey key;
+    key.MakeNewKey(true);
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(key.GetPubKey()));
+    CWalletBalances after = wallet.GetBalances();
+    BOOST_CHECK(after.nBalance > before.nBalance);
+    BOOST_CHECK_EQUAL(before.nBalance + before.nImmature, after.nBalance + after.nImmature);
+
+    wallet.MarkDirty();
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), after.nBalance);
+    BOOST_CHECK_EQUAL(wallet.GetImmatureBalance(), after.nImmature);
+}
+
+// Verify AvailableCoins() finds coins through setWalletUTXO, including
+// coins which became spendable again after their spend was abandoned.
+BOOST_FIXTURE_TEST_CASE(availablecoins_walletutxo, TestChain100Setup)
+{
+    LOCK(cs_main);
+
+    CWallet wallet;
+    LOCK(wallet.cs_wallet);
+    wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+    wallet.ScanForWalletTransactions(chainActive.Genesis());
+
+    // Coinbases from the last COINBASE_MATURITY blocks are still immature
+    std::vector<COutput> vAvailable;
+    wallet.AvailableCoins(vAvailable);
+    BOOST_CHECK_EQUAL(vAvailable.size(), coinbaseTxns.size() - COINBASE_MATURITY);
+
+    // Spend one of them with a tx which never makes it into the mempool
+    const COutput& coin = vAvailable.front();
+    CMutableTransaction spend;
+    spend.vin.push_back(CTxIn(coin.tx->GetHash(), coin.i));
+    spend.vout.push_back(CTxOut(coin.tx->tx->vout[coin.i].nValue / 2, GetScriptForRawPubKey(coinbaseKey.GetPubKey())));
+    CWalletTx wtx(&wallet, MakeTransactionRef(spend));
+    BOOST_CHECK(wallet.AddToWallet(wtx, false));
+    wallet.AvailableCoins(vAvailable, false);
+    BOOST_CHECK_EQUAL(vAvailable.size(), coinbaseTxns.size() - COINBASE_MATURITY - 1);
+
+    BOOST_CHECK(wallet.AbandonTransaction(wtx.GetHash()));
+    wallet.AvailableCoins(vAvailable);
+    BOOST_CHECK_EQUAL(vAvailable.size(), coinbaseTxns.size() - COINBASE_MATURITY);
+}
+
 // Verify importwallet RPC starts rescan at earliest block with timestamp
 // greater or equal than key birthday. Previously there was a bug where
 // importwallet RPC would start the scan at the latest block with timestamp less
@@ -71,6 +71,29 @@ const uint256 CMerkleTx::ABANDON_HASH(uint256S("00000000000000000000000000000000
  * @{
  */
 
+/**
+ * Wallet database handle for a single update: the open batch of the wallet
+ * if there is one, otherwise a short-lived CWalletDB of its own.
+ */
+class CWalletDBWriter
+{
+private:
+    std::unique_ptr<CWalletDB> pwalletdbOwned;
+    CWalletDB* pwalletdb;
+
+public:
+    CWalletDBWriter(CWalletDB* pwalletdbBatch, const std::string& strWalletFile, bool fFlushOnClose = true) : pwalletdb(pwalletdbBatch)
+    {
+        if (!pwalletdb) {
+            pwalletdbOwned.reset(new CWalletDB(strWalletFile, "r+", fFlushOnClose));
+            pwalletdb = pwalletdbOwned.get();
+        }
+    }
+
+    CWalletDB* operator->() { return pwalletdb; }
+    CWalletDB& operator*() { return *pwalletdb; }
+};
+
 struct CompareValueOnly
 {
     bool operator()(const std::pair<CAmount, std::pair<const CWalletTx*, unsigned int> >& t1,
@@ -205,33 +228,30 @@ CAmount GetStakeReward(CAmount blockReward, unsigned int percentage)
 {
     return (blockReward / 100) * percentage;
 }
-bool CWallet::CreateCoinStakeKernel(CScript &kernelScript, const CScript &stakeScript,
-                                    unsigned int nBits, const CBlock &blockFrom,
-                                    unsigned int nTxPrevOffset, const CTransactionRef &txPrev,
-                                    const COutPoint &prevout, unsigned int &nTimeTx, bool fPrintProofOfStake) const
+bool CWallet::CreateCoinStakeKernel(const CStakeCandidate& candidate, unsigned int nBits,
+                                    int64_t nMedianTimePast, unsigned int &nTimeTx) const
 {
     unsigned int nTryTime = 0;
     uint256 hashProofOfStake;
 
-    auto nStakeMinAge = blockFrom.GetBlockTime() > Params().GetConsensus().nStakeMinAgeSwitchTime ? Params().GetConsensus().nStakeMinAge_2 : Params().GetConsensus().nStakeMinAge;
+    auto nStakeMinAge = candidate.nBlockFromTime > Params().GetConsensus().nStakeMinAgeSwitchTime ? Params().GetConsensus().nStakeMinAge_2 : Params().GetConsensus().nStakeMinAge;
 
-    if (blockFrom.GetBlockTime() + nStakeMinAge + nHashDrift > nTimeTx) // Min age requirement
+    if (candidate.nBlockFromTime + nStakeMinAge + nHashDrift > nTimeTx) // Min age requirement
         return false;
     for(unsigned int i = 0; i < nHashDrift; ++i)
     {
         nTryTime = nTimeTx + nHashDrift - i;
-        if (CheckStakeKernelHash(nBits, blockFrom, nTxPrevOffset, txPrev, prevout, nTryTime, hashProofOfStake))
+        if (CheckStakeKernelHash(nBits, candidate.nBlockFromTime, candidate.nStakeModifier, sizeof(CBlock),
+                                 candidate.txout.nValue, candidate.prevout, nTryTime, hashProofOfStake))
         {
             //Double check that this will pass time requirements
-            if (nTryTime <= chainActive.Tip()->GetMedianTimePast()) {
+            if (nTryTime <= nMedianTimePast) {
                 LogPrintf("CreateCoinStakeKernel() : kernel found, but it is too far in the past \n");
                 continue;
             }
             // Found a kernel
             if (fDebug && GetBoolArg("-printcoinstake", false))
                 LogPrintf("CreateCoinStakeKernel : kernel found\n");
-            kernelScript.clear();
-            kernelScript = stakeScript;
             nTimeTx = nTryTime;
             return true;
         }
@@ -347,7 +367,7 @@ bool CWallet::AddHDPubKey(const CExtPubKey &extPubKey, bool fInternal)
     if (!fFileBacked)
         return true;
 
-    return CWalletDB(strWalletFile).WriteHDPubKey(hdPubKey, mapKeyMetadata[extPubKey.pubkey.GetID()]);
+    return CWalletDBWriter(pwalletdbBatch, strWalletFile)->WriteHDPubKey(hdPubKey, mapKeyMetadata[extPubKey.pubkey.GetID()]);
 }
 
 bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
@@ -368,9 +388,9 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
     if (!fFileBacked)
         return true;
     if (!IsCrypted()) {
-        return CWalletDB(strWalletFile).WriteKey(pubkey,
-                                                 secret.GetPrivKey(),
-                                                 mapKeyMetadata[pubkey.GetID()]);
+        return CWalletDBWriter(pwalletdbBatch, strWalletFile)->WriteKey(pubkey,
+                                                                        secret.GetPrivKey(),
+                                                                        mapKeyMetadata[pubkey.GetID()]);
     }
     return true;
 }
@@ -389,9 +409,9 @@ bool CWallet::AddCryptedKey(const CPubKey &vchPubKey,
                                                         vchCryptedSecret,
                                                         mapKeyMetadata[vchPubKey.GetID()]);
         else
-            return CWalletDB(strWalletFile).WriteCryptedKey(vchPubKey,
-                                                            vchCryptedSecret,
-                                                            mapKeyMetadata[vchPubKey.GetID()]);
+            return CWalletDBWriter(pwalletdbBatch, strWalletFile)->WriteCryptedKey(vchPubKey,
+                                                                                   vchCryptedSecret,
+                                                                                   mapKeyMetadata[vchPubKey.GetID()]);
     }
     return false;
 }
@@ -427,7 +447,8 @@ bool CWallet::AddCScript(const CScript& redeemScript)
         return false;
     if (!fFileBacked)
         return true;
-    return CWalletDB(strWalletFile).WriteCScript(Hash160(redeemScript), redeemScript);
+    LOCK(cs_wallet); // pwalletdbBatch
+    return CWalletDBWriter(pwalletdbBatch, strWalletFile)->WriteCScript(Hash160(redeemScript), redeemScript);
 }
 
 bool CWallet::LoadCScript(const CScript& redeemScript)
@@ -448,6 +469,7 @@ bool CWallet::LoadCScript(const CScript& redeemScript)
 
 bool CWallet::AddWatchOnly(const CScript& dest)
 {
+    LOCK(cs_wallet); // mapKeyMetadata, pwalletdbBatch
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
     const CKeyMetadata& meta = mapKeyMetadata[CScriptID(dest)];
@@ -455,7 +477,7 @@ bool CWallet::AddWatchOnly(const CScript& dest)
     NotifyWatchonlyChanged(true);
     if (!fFileBacked)
         return true;
-    return CWalletDB(strWalletFile).WriteWatchOnly(dest, meta);
+    return CWalletDBWriter(pwalletdbBatch, strWalletFile)->WriteWatchOnly(dest, meta);
 }
 
 bool CWallet::AddWatchOnly(const CScript& dest, int64_t nCreateTime)
@@ -472,7 +494,7 @@ bool CWallet::RemoveWatchOnly(const CScript &dest)
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
     if (fFileBacked)
-        if (!CWalletDB(strWalletFile).EraseWatchOnly(dest))
+        if (!CWalletDBWriter(pwalletdbBatch, strWalletFile)->EraseWatchOnly(dest))
             return false;
 
     return true;
@@ -602,8 +624,8 @@ bool CWallet::ChangeWalletPassphrase(const SecureString& strOldWalletPassphrase,
 
 void CWallet::SetBestChain(const CBlockLocator& loc)
 {
-    CWalletDB walletdb(strWalletFile);
-    walletdb.WriteBestBlock(loc);
+    LOCK(cs_wallet); // pwalletdbBatch
+    CWalletDBWriter(pwalletdbBatch, strWalletFile)->WriteBestBlock(loc);
 }
 
 bool CWallet::SetMinVersion(enum WalletFeature nVersion, CWalletDB* pwalletdbIn, bool fExplicit)
@@ -623,11 +645,9 @@ bool CWallet::SetMinVersion(enum WalletFeature nVersion, CWalletDB* pwalletdbIn,
 
     if (fFileBacked)
     {
-        CWalletDB* pwalletdb = pwalletdbIn ? pwalletdbIn : new CWalletDB(strWalletFile);
+        CWalletDBWriter walletdb(pwalletdbIn ? pwalletdbIn : pwalletdbBatch, strWalletFile);
         if (nWalletVersion > 40000)
-            pwalletdb->WriteMinVersion(nWalletVersion);
-        if (!pwalletdbIn)
-            delete pwalletdb;
+            walletdb->WriteMinVersion(nWalletVersion);
     }
 
     return true;
@@ -792,6 +812,22 @@ bool CWallet::IsSpent(const uint256& hash, unsigned int n) const
     return false;
 }
 
+void CWallet::SyncWalletUTXO(const uint256& hashTx)
+{
+    AssertLockHeld(cs_wallet);
+
+    std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hashTx);
+    if (it == mapWallet.end())
+        return;
+
+    const CWalletTx& wtx = it->second;
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
+        if (IsMine(wtx.tx->vout[i]) && !IsSpent(hashTx, i)) {
+            setWalletUTXO.insert(COutPoint(hashTx, i));
+        }
+    }
+}
+
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
@@ -1022,15 +1058,59 @@ DBErrors CWallet::ReorderTransactions()
     return DB_LOAD_OK;
 }
 
+void CWallet::BeginDBBatch(bool fFlushOnClose)
+{
+    AssertLockHeld(cs_wallet); // pwalletdbBatch
+    if (nWalletDBBatchDepth++ > 0 || !fFileBacked)
+        return;
+
+    pwalletdbBatch = new CWalletDB(strWalletFile, "r+", fFlushOnClose);
+    if (!pwalletdbBatch->TxnBegin()) {
+        LogPrintf("%s: could not begin a database transaction, writing unbatched\n", __func__);
+        delete pwalletdbBatch;
+        pwalletdbBatch = NULL;
+    }
+}
+
+bool CWallet::CommitDBBatch()
+{
+    AssertLockHeld(cs_wallet); // pwalletdbBatch
+    assert(nWalletDBBatchDepth > 0);
+    if (--nWalletDBBatchDepth > 0 || !pwalletdbBatch)
+        return true;
+
+    bool fCommitted = pwalletdbBatch->TxnCommit();
+    if (!fCommitted)
+        LogPrintf("%s: committing batched wallet writes failed\n", __func__);
+    // Closing the handle checkpoints everything written in the batch at once,
+    // unless the batch was begun without flushing on close
+    delete pwalletdbBatch;
+    pwalletdbBatch = NULL;
+    return fCommitted;
+}
+
+bool CWallet::CheckpointDBBatch()
+{
+    AssertLockHeld(cs_wallet); // pwalletdbBatch
+    if (!pwalletdbBatch)
+        return true;
+
+    bool fCommitted = pwalletdbBatch->TxnCommit();
+    if (!fCommitted)
+        LogPrintf("%s: committing batched wallet writes failed\n", __func__);
+    if (!pwalletdbBatch->TxnBegin()) {
+        LogPrintf("%s: could not begin a database transaction, writing unbatched\n", __func__);
+        delete pwalletdbBatch;
+        pwalletdbBatch = NULL;
+    }
+    return fCommitted;
+}
+
 int64_t CWallet::IncOrderPosNext(CWalletDB *pwalletdb)
 {
     AssertLockHeld(cs_wallet); // nOrderPosNext
     int64_t nRet = nOrderPosNext++;
-    if (pwalletdb) {
-        pwalletdb->WriteOrderPosNext(nOrderPosNext);
-    } else {
-        CWalletDB(strWalletFile).WriteOrderPosNext(nOrderPosNext);
-    }
+    CWalletDBWriter(pwalletdb ? pwalletdb : pwalletdbBatch, strWalletFile)->WriteOrderPosNext(nOrderPosNext);
     return nRet;
 }
 
@@ -1110,19 +1190,34 @@ void CWallet::MarkDirty()
 {
     {
         LOCK(cs_wallet);
-        BOOST_FOREACH(PAIRTYPE(const uint256, CWalletTx)& item, mapWallet)
+        fBalancesFullRecalc = true;
+        fStakeCoinsFullRebuild = true;
+        BOOST_FOREACH(PAIRTYPE(const uint256, CWalletTx)& item, mapWallet) {
             item.second.MarkDirty();
+            // IsMine() may have changed, e.g. after an import
+            SyncWalletUTXO(item.first);
+        }
     }
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
 }
 
+void CWallet::MarkTxDirty(const uint256& hashTx) const
+{
+    LOCK(cs_wallet);
+    if (!fBalancesFullRecalc)
+        setBalancesDirty.insert(hashTx);
+    if (!fStakeCoinsFullRebuild)
+        setStakeCoinsDirty.insert(hashTx);
+}
+
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 {
     LOCK(cs_wallet);
 
-    CWalletDB walletdb(strWalletFile, "r+", fFlushOnClose);
+    CWalletDBWriter walletdbWriter(pwalletdbBatch, strWalletFile, fFlushOnClose);
+    CWalletDB& walletdb = *walletdbWriter;
 
     uint256 hash = wtxIn.GetHash();
 
@@ -1133,6 +1228,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
     bool fInsertedNew = ret.second;
     if (fInsertedNew)
     {
+        // wtxIn may be a copy of a tx tallied by another wallet
+        wtx.fBalancesTallied = false;
         wtx.nTimeReceived = GetAdjustedTime();
         wtx.nOrderPos = IncOrderPosNext(&walletdb);
         wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
@@ -1182,12 +1279,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
                          wtxIn.hashBlock.ToString());
         }
         AddToSpends(hash);
-        for(unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
-            if (IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
-                setWalletUTXO.insert(COutPoint(hash, i));
-            }
-        }
     }
+    // Also on updates, outputs may have become ours since the tx was added
+    SyncWalletUTXO(hash);
 
     bool fUpdated = false;
     if (!fInsertedNew)
@@ -1249,6 +1343,10 @@ bool CWallet::LoadToWallet(const CWalletTx& wtxIn)
 {
     uint256 hash = wtxIn.GetHash();
 
+    // Overwriting an entry loses its tallied balances and invalidates
+    // pointers into it, start over
+    fBalancesFullRecalc = true;
+    fStakeCoinsFullRebuild = true;
     mapWallet[hash] = wtxIn;
     CWalletTx& wtx = mapWallet[hash];
     wtx.BindWallet(this);
@@ -1284,11 +1382,18 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex
     {
         AssertLockHeld(cs_wallet);
 
+        // The tx and the wallet txs it conflicts go out in one commit. The batch is
+        // only opened once the tx turns out to concern the wallet, and like the
+        // writes in it, doesn't flush the wallet for performance reasons.
+        std::unique_ptr<CWalletDBBatch> batch;
+
         if (posInBlock != -1) {
             BOOST_FOREACH(const CTxIn& txin, tx.vin) {
                 std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(txin.prevout);
                 while (range.first != range.second) {
                     if (range.first->second != tx.GetHash()) {
+                        if (!batch)
+                            batch.reset(new CWalletDBBatch(*this, false));
                         LogPrintf("Transaction %s (in block %s) conflicts with wallet transaction %s (both spend %s:%i)\n", tx.GetHash().ToString(), pIndex->GetBlockHash().ToString(), range.first->second.ToString(), range.first->first.hash.ToString(), range.first->first.n);
                         MarkConflicted(pIndex->GetBlockHash(), range.first->second);
                     }
@@ -1307,6 +1412,8 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex
             if (posInBlock != -1)
                 wtx.SetMerkleBranch(pIndex, posInBlock);
 
+            if (!batch)
+                batch.reset(new CWalletDBBatch(*this, false));
             return AddToWallet(wtx, false);
         }
     }
@@ -1317,7 +1424,8 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
 {
     LOCK2(cs_main, cs_wallet);
 
-    CWalletDB walletdb(strWalletFile, "r+");
+    CWalletDBWriter walletdbWriter(pwalletdbBatch, strWalletFile);
+    CWalletDB& walletdb = *walletdbWriter;
 
     std::set<uint256> todo;
     std::set<uint256> done;
@@ -1361,8 +1469,10 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             // available of the outputs it spends. So force those to be recomputed
             BOOST_FOREACH(const CTxIn& txin, wtx.tx->vin)
             {
-                if (mapWallet.count(txin.prevout.hash))
+                if (mapWallet.count(txin.prevout.hash)) {
                     mapWallet[txin.prevout.hash].MarkDirty();
+                    SyncWalletUTXO(txin.prevout.hash);
+                }
             }
         }
     }
@@ -1392,7 +1502,8 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
         return;
 
     // Do not flush the wallet here for performance reasons
-    CWalletDB walletdb(strWalletFile, "r+", false);
+    CWalletDBWriter walletdbWriter(pwalletdbBatch, strWalletFile, false);
+    CWalletDB& walletdb = *walletdbWriter;
 
     std::set<uint256> todo;
     std::set<uint256> done;
@@ -1425,8 +1536,10 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             // available of the outputs it spends. So force those to be recomputed
             BOOST_FOREACH(const CTxIn& txin, wtx.tx->vin)
             {
-                if (mapWallet.count(txin.prevout.hash))
+                if (mapWallet.count(txin.prevout.hash)) {
                     mapWallet[txin.prevout.hash].MarkDirty();
+                    SyncWalletUTXO(txin.prevout.hash);
+                }
             }
         }
     }
@@ -1679,7 +1792,7 @@ bool CWallet::SetHDChain(const CHDChain& chain, bool memonly)
     if (!CCryptoKeyStore::SetHDChain(chain))
         return false;
 
-    if (!memonly && !CWalletDB(strWalletFile).WriteHDChain(chain))
+    if (!memonly && !CWalletDBWriter(pwalletdbBatch, strWalletFile)->WriteHDChain(chain))
         throw std::runtime_error(std::string(__func__) + ": WriteHDChain failed");
 
     return true;
@@ -1699,7 +1812,7 @@ bool CWallet::SetCryptedHDChain(const CHDChain& chain, bool memonly)
             if (!pwalletdbEncryption->WriteCryptedHDChain(chain))
                 throw std::runtime_error(std::string(__func__) + ": WriteCryptedHDChain failed");
         } else {
-            if (!CWalletDB(strWalletFile).WriteCryptedHDChain(chain))
+            if (!CWalletDBWriter(pwalletdbBatch, strWalletFile)->WriteCryptedHDChain(chain))
                 throw std::runtime_error(std::string(__func__) + ": WriteCryptedHDChain failed");
         }
     }
@@ -1958,6 +2071,7 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
     CBlockIndex* pindex = pindexStart;
     {
         LOCK2(cs_main, cs_wallet);
+        CWalletDBBatch batch(*this);
 
         // no need to read and scan block, if block was created before
         // our wallet birthday (as adjusted for block time variability)
@@ -1987,6 +2101,8 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
             } else {
                 ret = nullptr;
             }
+            if (pindex->nHeight % 1000 == 0)
+                CheckpointDBBatch();
             pindex = chainActive.Next(pindex);
         }
         ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
@@ -2066,6 +2182,25 @@ std::set<uint256> CWalletTx::GetConflicts() const
     return result;
 }
 
+void CWalletTx::MarkDirty()
+{
+    fCreditCached = false;
+    fAvailableCreditCached = false;
+    fImmatureCreditCached = false;
+    fAnonymizedCreditCached = false;
+    fDenomUnconfCreditCached = false;
+    fDenomConfCreditCached = false;
+    fWatchDebitCached = false;
+    fWatchCreditCached = false;
+    fAvailableWatchCreditCached = false;
+    fImmatureWatchCreditCached = false;
+    fDebitCached = false;
+    fChangeCached = false;
+
+    if (pwallet != NULL)
+        pwallet->MarkTxDirty(GetHash());
+}
+
 CAmount CWalletTx::GetDebit(const isminefilter& filter) const
 {
     if (tx->vin.empty())
@@ -2412,20 +2547,89 @@ void CWallet::ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman
  */
 
 
-CAmount CWallet::GetBalance() const
+void CWallet::TallyBalances(const CWalletTx& wtx) const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableCredit();
+    const uint256& hash = wtx.GetHash();
+
+    if (wtx.fBalancesTallied)
+        balancesTotal -= wtx.balancesTallied;
+    setBalancesUnconfirmed.erase(hash);
+    setBalancesImmature.erase(hash);
+
+    CWalletBalances balances;
+    bool fTrusted = wtx.IsTrusted();
+    if (fTrusted) {
+        balances.nBalance = wtx.GetAvailableCredit();
+        balances.nWatchOnly = wtx.GetAvailableWatchOnlyCredit();
+    } else if (wtx.GetDepthInMainChain() == 0 && wtx.InMempool()) {
+        balances.nUnconfirmed = wtx.GetAvailableCredit();
+        balances.nUnconfirmedWatchOnly = wtx.GetAvailableWatchOnlyCredit();
+    }
+    balances.nImmature = wtx.GetImmatureCredit();
+    balances.nImmatureWatchOnly = wtx.GetImmatureWatchOnlyCredit();
+    if (!fLiteMode) {
+        if (fTrusted)
+            balances.nAnonymized = wtx.GetAnonymizedCredit();
+        balances.nDenominatedConfirmed = wtx.GetDenominatedCredit(false);
+        balances.nDenominatedUnconfirmed = wtx.GetDenominatedCredit(true);
+    }
+
+    if (wtx.GetDepthInMainChain(false) < 1)
+        setBalancesUnconfirmed.insert(hash);
+    else if (wtx.GetBlocksToMaturity() > 0)
+        setBalancesImmature.insert(hash);
+
+    wtx.balancesTallied = balances;
+    wtx.fBalancesTallied = true;
+    balancesTotal += balances;
+}
+
+void CWallet::UpdateBalances() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    uint256 hashTip = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256();
+
+    if (fBalancesFullRecalc) {
+        balancesTotal.SetNull();
+        setBalancesDirty.clear();
+        setBalancesUnconfirmed.clear();
+        setBalancesImmature.clear();
+        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
+            it->second.fBalancesTallied = false;
+            TallyBalances(it->second);
         }
+        hashBalancesTip = hashTip;
+        fBalancesFullRecalc = false;
+        return;
     }
 
-    return nTotal;
+    if (hashTip != hashBalancesTip) {
+        setBalancesDirty.insert(setBalancesImmature.begin(), setBalancesImmature.end());
+        hashBalancesTip = hashTip;
+    }
+    // Mempool and InstantSend lock changes are not signalled to the wallet
+    setBalancesDirty.insert(setBalancesUnconfirmed.begin(), setBalancesUnconfirmed.end());
+
+    for (const uint256& hash : setBalancesDirty) {
+        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+        if (it != mapWallet.end())
+            TallyBalances(it->second);
+    }
+    setBalancesDirty.clear();
+}
+
+CWalletBalances CWallet::GetBalances() const
+{
+    LOCK2(cs_main, cs_wallet);
+    UpdateBalances();
+    return balancesTotal;
+}
+
+CAmount CWallet::GetBalance() const
+{
+    return GetBalances().nBalance;
 }
 
 // ppcoin: total coins staked (non-spendable until maturity)
@@ -2450,9 +2654,127 @@ CAmount CWallet::GetStake() const
 
 int CWallet::GetStakeInputs() const
 {
-    static StakeCoinsSet setStakeCoins;
-    int StakeInputs = (int) setStakeCoins.size();
-    return StakeInputs;
+    LOCK2(cs_main, cs_wallet);
+    UpdateStakeCoins();
+    return (int) setStakeCoins.size();
+}
+
+int CWallet::GetPendingStakeInputs() const
+{
+    LOCK2(cs_main, cs_wallet);
+    UpdateStakeCoins();
+    return (int) setStakeCoinsPending.size();
+}
+
+CAmount CWallet::GetStakeWeight() const
+{
+    LOCK2(cs_main, cs_wallet);
+    UpdateStakeCoins();
+    CAmount nWeight = 0;
+    for (const auto& coin : setStakeCoins)
+        nWeight += coin.first->tx->vout[coin.second].nValue;
+    return nWeight;
+}
+
+static bool IsStakeCoinMature(const CWalletTx* pcoin, int nDepth)
+{
+    //check for min age
+    auto nStakeMinAge = pcoin->GetTxTime() > Params().GetConsensus().nStakeMinAgeSwitchTime ? Params().GetConsensus().nStakeMinAge_2 : Params().GetConsensus().nStakeMinAge;
+    if (GetTime() - pcoin->GetTxTime() < nStakeMinAge)
+        return false;
+    //check that it is matured
+    return nDepth >= (pcoin->tx->IsCoinStake() ? COINBASE_MATURITY : 10);
+}
+
+void CWallet::AddStakeCandidate(const COutput& out) const
+{
+    if (out.tx->tx->vout[out.i].scriptPubKey.IsPayToScriptHash())
+        return;
+
+    std::pair<const CWalletTx*, unsigned int> coin(out.tx, out.i);
+    if (IsStakeCoinMature(out.tx, out.nDepth))
+        setStakeCoins.insert(coin);
+    else
+        setStakeCoinsPending.insert(coin);
+}
+
+void CWallet::AddStakeCandidatesFromTx(const CWalletTx* pcoin) const
+{
+    setStakeCoinsImmature.erase(pcoin->GetHash());
+    if (pcoin->GetBlocksToMaturity() > 0 && pcoin->IsInMainChain()) {
+        setStakeCoinsImmature.insert(pcoin->GetHash());
+        return;
+    }
+
+    std::vector<COutput> vCoins;
+    AvailableCoinsFromTx(vCoins, pcoin, true, NULL, false, ALL_COINS, false);
+    for (const COutput& out : vCoins)
+        AddStakeCandidate(out);
+}
+
+void CWallet::UpdateStakeCoins() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    uint256 hashTip = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256();
+
+    if (fStakeCoinsFullRebuild) {
+        setStakeCoins.clear();
+        setStakeCoinsPending.clear();
+        setStakeCoinsDirty.clear();
+        setStakeCoinsImmature.clear();
+        uint256 hashPrev;
+        for (const auto& outpoint : setWalletUTXO) {
+            if (outpoint.hash == hashPrev)
+                continue;
+            hashPrev = outpoint.hash;
+            std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(outpoint.hash);
+            if (mi != mapWallet.end())
+                AddStakeCandidatesFromTx(&mi->second);
+        }
+        hashStakeCoinsTip = hashTip;
+        fStakeCoinsFullRebuild = false;
+        LogPrint("staking", "Selected %d coins for staking, %d pending\n", setStakeCoins.size(), setStakeCoinsPending.size());
+        return;
+    }
+
+    // Coinbase outputs reach maturity with the blocks connected on top of them
+    if (hashTip != hashStakeCoinsTip) {
+        for (const uint256& hash : setStakeCoinsImmature) {
+            std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(hash);
+            if (mi == mapWallet.end() || mi->second.GetBlocksToMaturity() == 0)
+                setStakeCoinsDirty.insert(hash);
+        }
+        hashStakeCoinsTip = hashTip;
+    }
+
+    // Transactions which were added, confirmed, matured or had outputs spent
+    for (const uint256& hash : setStakeCoinsDirty) {
+        std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(hash);
+        if (mi == mapWallet.end()) {
+            setStakeCoinsImmature.erase(hash);
+            continue;
+        }
+        const CWalletTx* pcoin = &mi->second;
+        for (auto* pset : {&setStakeCoins, &setStakeCoinsPending}) {
+            auto it = pset->lower_bound(std::make_pair(pcoin, 0u));
+            while (it != pset->end() && it->first == pcoin)
+                it = pset->erase(it);
+        }
+        AddStakeCandidatesFromTx(pcoin);
+    }
+    setStakeCoinsDirty.clear();
+
+    // Coins gain stake age and confirmations without their tx changing
+    for (auto it = setStakeCoinsPending.begin(); it != setStakeCoinsPending.end(); ) {
+        if (IsStakeCoinMature(it->first, it->first->GetDepthInMainChain(false))) {
+            setStakeCoins.insert(*it);
+            it = setStakeCoinsPending.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 
@@ -2482,23 +2804,7 @@ CAmount CWallet::GetAnonymizedBalance() const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-
-    LOCK2(cs_main, cs_wallet);
-
-    std::set<uint256> setWalletTxesCounted;
-    for (const auto& outpoint : setWalletUTXO) {
-
-        if (setWalletTxesCounted.find(outpoint.hash) != setWalletTxesCounted.end()) continue;
-        setWalletTxesCounted.insert(outpoint.hash);
-
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash); it != mapWallet.end() && it->first == outpoint.hash; ++it) {
-            if (it->second.IsTrusted())
-                nTotal += it->second.GetAnonymizedCredit();
-        }
-    }
-
-    return nTotal;
+    return GetBalances().nAnonymized;
 }
 
 // Note: calculated including unconfirmed,
@@ -2574,92 +2880,33 @@ CAmount CWallet::GetDenominatedBalance(bool unconfirmed) const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-
-            nTotal += pcoin->GetDenominatedCredit(unconfirmed);
-        }
-    }
-
-    return nTotal;
+    CWalletBalances balances = GetBalances();
+    return unconfirmed ? balances.nDenominatedUnconfirmed : balances.nDenominatedConfirmed;
 }
 
 CAmount CWallet::GetUnconfirmedBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nUnconfirmed;
 }
 
 CAmount CWallet::GetImmatureBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nImmature;
 }
 
 CAmount CWallet::GetWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-
-    return nTotal;
+    return GetBalances().nWatchOnly;
 }
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nUnconfirmedWatchOnly;
 }
 
 CAmount CWallet::GetImmatureWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nImmatureWatchOnly;
 }
 
 void CWallet::AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue, AvailableCoinsType nCoinType, bool fUseInstantSend) const
@@ -2668,64 +2915,78 @@ void CWallet::AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed,
 
     {
         LOCK2(cs_main, cs_wallet);
-        int nInstantSendConfirmationsRequired = Params().GetConsensus().nInstantSendConfirmationsRequired;
 
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        // Only transactions with unspent outputs of ours can provide coins.
+        // setWalletUTXO may contain outpoints which were spent since, these
+        // are filtered by the IsSpent() check in AvailableCoinsFromTx().
+        uint256 hashPrev;
+        for (const auto& outpoint : setWalletUTXO)
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
-
-            if (!CheckFinalTx(*pcoin))
+            if (outpoint.hash == hashPrev)
                 continue;
+            hashPrev = outpoint.hash;
 
-            if (fOnlyConfirmed && !pcoin->IsTrusted())
+            std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
+            if (it == mapWallet.end())
                 continue;
 
-            if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-                continue;
+            AvailableCoinsFromTx(vCoins, &it->second, fOnlyConfirmed, coinControl, fIncludeZeroValue, nCoinType, fUseInstantSend);
+        }
+    }
+}
 
-            int nDepth = pcoin->GetDepthInMainChain(false);
-            // do not use IX for inputs that have less then nInstantSendConfirmationsRequired blockchain confirmations
-            if (fUseInstantSend && nDepth < nInstantSendConfirmationsRequired)
-                continue;
+void CWallet::AvailableCoinsFromTx(std::vector<COutput>& vCoins, const CWalletTx* pcoin, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue, AvailableCoinsType nCoinType, bool fUseInstantSend) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
 
-            // We should not consider coins which aren't at least in our mempool
-            // It's possible for these to be conflicted via ancestors which we may never be able to detect
-            if (nDepth == 0 && !pcoin->InMempool())
-                continue;
+    const uint256& wtxid = pcoin->GetHash();
+    int nInstantSendConfirmationsRequired = Params().GetConsensus().nInstantSendConfirmationsRequired;
 
-            // We should not consider coins which aren't at least in our mempool
-            // It's possible for these to be conflicted via ancestors which we may never be able to detect
-            if (nDepth == 0 && !pcoin->InMempool())
-                continue;
+    if (!CheckFinalTx(*pcoin))
+        return;
 
-            for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-                bool found = false;
-                if(nCoinType == ONLY_DENOMINATED) {
-                    found = CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[i].nValue);
-                } else if(nCoinType == ONLY_NONDENOMINATED) {
-                    if (CPrivateSend::IsCollateralAmount(pcoin->tx->vout[i].nValue)) continue; // do not use collateral amounts
-                    found = !CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[i].nValue);
-                } else if(nCoinType == ONLY_1000) {
-                    found = pcoin->tx->vout[i].nValue == 1000*COIN;
-                } else if(nCoinType == ONLY_PRIVATESEND_COLLATERAL) {
-                    found = CPrivateSend::IsCollateralAmount(pcoin->tx->vout[i].nValue);
-                } else {
-                    found = true;
-                }
-                if(!found) continue;
-
-                isminetype mine = IsMine(pcoin->tx->vout[i]);
-                if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    (!IsLockedCoin((*it).first, i) || nCoinType == ONLY_1000) &&
-                    (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i))))
-                        vCoins.push_back(COutput(pcoin, i, nDepth,
-                                                 ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
-                                                  (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
-                                                 (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
-            }
+    if (fOnlyConfirmed && !pcoin->IsTrusted())
+        return;
+
+    if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
+        return;
+
+    int nDepth = pcoin->GetDepthInMainChain(false);
+    // do not use IX for inputs that have less then nInstantSendConfirmationsRequired blockchain confirmations
+    if (fUseInstantSend && nDepth < nInstantSendConfirmationsRequired)
+        return;
+
+    // We should not consider coins which aren't at least in our mempool
+    // It's possible for these to be conflicted via ancestors which we may never be able to detect
+    if (nDepth == 0 && !pcoin->InMempool())
+        return;
+
+    for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
+        bool found = false;
+        if(nCoinType == ONLY_DENOMINATED) {
+            found = CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[i].nValue);
+        } else if(nCoinType == ONLY_NONDENOMINATED) {
+            if (CPrivateSend::IsCollateralAmount(pcoin->tx->vout[i].nValue)) continue; // do not use collateral amounts
+            found = !CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[i].nValue);
+        } else if(nCoinType == ONLY_1000) {
+            found = pcoin->tx->vout[i].nValue == 1000*COIN;
+        } else if(nCoinType == ONLY_PRIVATESEND_COLLATERAL) {
+            found = CPrivateSend::IsCollateralAmount(pcoin->tx->vout[i].nValue);
+        } else {
+            found = true;
         }
+        if(!found) continue;
+
+        isminetype mine = IsMine(pcoin->tx->vout[i]);
+        if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
+            (!IsLockedCoin(wtxid, i) || nCoinType == ONLY_1000) &&
+            (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
+            (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint(wtxid, i))))
+                vCoins.push_back(COutput(pcoin, i, nDepth,
+                                         ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
+                                          (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
+                                         (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
     }
 }
 
@@ -2930,57 +3191,9 @@ bool CWallet::MintableCoins()
     //        return error("MintableCoins() : invalid reserve balance amount");
     //    if (nBalance <= nReserveBalance)
     //        return false;
-    std::vector<COutput> vCoins;
     LOCK2(cs_main, cs_wallet);
-    AvailableCoins(vCoins, true);
-    for (const COutput& out : vCoins)
-    {
-        auto nStakeMinAge = out.tx->GetTxTime() > Params().GetConsensus().nStakeMinAgeSwitchTime ? Params().GetConsensus().nStakeMinAge_2 : Params().GetConsensus().nStakeMinAge;
-
-        if (GetTime() - out.tx->GetTxTime() > nStakeMinAge)
-        {
-            return true;
-        }
-    }
-    return false;
-}
-bool CWallet::SelectStakeCoins(StakeCoinsSet &setCoins, CAmount nTargetAmount, const CScript &scriptFilterPubKey) const
-{
-    std::vector<COutput> vCoins;
-    AvailableCoins(vCoins, scriptFilterPubKey.empty());
-    CAmount nAmountSelected = 0;
-    std::set<CScript> rejectCache;
-    for (const COutput& out : vCoins) {
-        //make sure not to outrun target amount
-        CScript scriptPubKeyKernel;
-        scriptPubKeyKernel = out.tx->tx->vout[out.i].scriptPubKey;
-        if(scriptPubKeyKernel.IsPayToScriptHash())
-            continue;
-        //     LogPrintf("scriptPubKeyKernel is good\n");
-        //for now we will comment this out
-        //        if (nAmountSelected + out.tx->vout[out.i].nValue > nTargetAmount)
-        //            continue;
-        //        LogPrintf("amount is good\n");
-        //check for min age
-        auto nStakeMinAge = out.tx->GetTxTime() > Params().GetConsensus().nStakeMinAgeSwitchTime ? Params().GetConsensus().nStakeMinAge_2 : Params().GetConsensus().nStakeMinAge;
-        if (GetTime() - out.tx->GetTxTime() < nStakeMinAge)
-            continue;
-        //  LogPrintf("min age is good\n");
-        //check that it is matured
-        if (out.nDepth < (out.tx->tx->IsCoinStake() ? COINBASE_MATURITY : 10))
-            continue;
-        //  LogPrintf("maturity is good\n");
-        auto scriptPubKeyCoin = out.tx->tx->vout[out.i].scriptPubKey;
-        if(!scriptFilterPubKey.empty() && scriptPubKeyCoin != scriptFilterPubKey)
-            continue;
-        //   LogPrintf("filtering is good\n");
-        if(rejectCache.count(scriptPubKeyCoin))
-            continue;
-        //    LogPrintf("reject is good\n");
-        nAmountSelected += out.tx->tx->vout[out.i].nValue; //maybe change here for tpos
-        setCoins.insert(std::make_pair(out.tx, out.i));
-    }
-    return true;
+    UpdateStakeCoins();
+    return !setStakeCoins.empty();
 }
 
 bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl* coinControl, AvailableCoinsType nCoinType, bool fUseInstantSend) const
@@ -4026,6 +4239,11 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, CCon
             // Broadcast
             if (!wtxNew.AcceptToMemoryPool(maxTxFee, state)) {
                 LogPrintf("CommitTransaction(): Transaction cannot be broadcast immediately, %s\n", state.GetRejectReason());
+                // AddToWallet dropped the inputs from the stake candidates expecting the spend
+                // to reach the mempool. It did not, so have the next UpdateStakeCoins decide
+                // by IsSpent() again rather than keep that assumption.
+                for (const CTxIn& txin : wtxNew.tx->vin)
+                    MarkTxDirty(txin.prevout.hash);
                 // TODO: if we expect the failure to be long term or permanent, instead delete wtx from the wallet and return failure.
             } else {
                 wtxNew.RelayWalletTransaction(connman, strCommand);
@@ -4040,16 +4258,15 @@ void CWallet::ListAccountCreditDebit(const std::string& strAccount, std::list<CA
     return walletdb.ListAccountCreditDebit(strAccount, entries);
 }
 
-bool CWallet::CreateCoinStake(unsigned int nBits,
+bool CWallet::CreateCoinStake(const CBlockIndex* pindexPrev,
+                              unsigned int nBits,
                               CAmount blockReward,
                               CMutableTransaction &txNew,
-                              unsigned int &nTxNewTime,
-                              std::vector<CWalletTx*> &vwtxPrev)
+                              unsigned int &nTxNewTime)
 {
     // The following split & combine thresholds are important to security
     // Should not be adjusted if you don't understand the consequences
     //int64_t nCombineThreshold = 0;
-    CBlockIndex* pindexPrev = pindexBestHeader;
     txNew.vin.clear();
     txNew.vout.clear();
     // Mark coin stake transaction
@@ -4057,55 +4274,52 @@ bool CWallet::CreateCoinStake(unsigned int nBits,
     scriptEmpty.clear();
     txNew.vout.emplace_back(CTxOut(0, scriptEmpty));
     // Choose coins to use
-    CAmount nBalance = GetBalance();
     //    if (mapArgs.count("-reservebalance") && !ParseMoney(mapArgs["-reservebalance"], nReserveBalance))
     //        return error("CreateCoinStake : invalid reserve balance amount");
     //    if (nBalance <= nReserveBalance)
     //        return false;
-    //  presstab HyperStake - Initialize as static and don't update the set on every run of CreateCoinStake() in order to lighten resource use
-    static StakeCoinsSet setStakeCoins;
-    static int nLastStakeSetUpdate = 0;
-    if (GetTime() - nLastStakeSetUpdate > nStakeSetUpdateTime) {
-        setStakeCoins.clear();
-        CScript scriptPubKey;
-        if (!SelectStakeCoins(setStakeCoins, nBalance /*- nReserveBalance*/, scriptPubKey)) {
-            return error("Failed to select coins for staking");
+    //prevent staking a time that won't be accepted
+    //the caller retries with a fresh tip, rather than waiting here
+    if (GetAdjustedTime() <= pindexPrev->nTime)
+        return false;
+    // Take everything the kernel hashes from the chain and the stake coin
+    // set at once, the search below runs without cs_main and cs_wallet
+    std::vector<CStakeCandidate> vCandidates;
+    {
+        LOCK2(cs_main, cs_wallet);
+        UpdateStakeCoins();
+        vCandidates.reserve(setStakeCoins.size());
+        for (const std::pair<const CWalletTx*, unsigned int> &pcoin : setStakeCoins)
+        {
+            BlockMap::iterator it = mapBlockIndex.find(pcoin.first->hashBlock);
+            if (it == mapBlockIndex.end()) {
+                LogPrintf("failed to find block index ");
+                continue;
+            }
+            CStakeCandidate candidate;
+            candidate.prevout = COutPoint(pcoin.first->GetHash(), pcoin.second);
+            candidate.txout = pcoin.first->tx->vout[pcoin.second];
+            candidate.nBlockFromTime = it->second->GetBlockTime();
+            if (!GetKernelStakeModifier(it->second->GetBlockHash(), GetAdjustedTime(), candidate.nStakeModifier))
+                continue;
+            vCandidates.push_back(candidate);
         }
-        LogPrintf("Selected %d coins for staking\n", setStakeCoins.size());
-        nLastStakeSetUpdate = GetTime();
     }
-    if (setStakeCoins.empty())
+    if (vCandidates.empty())
         return error("CreateCoinStake() : No Coins to stake");
-    //prevent staking a time that won't be accepted
-    if (GetAdjustedTime() <= chainActive.Tip()->nTime)
-        MilliSleep(10000);
+    // Block index entries aren't modified once connected
+    const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
     bool fKernelFound = false;
-    CAmount nCredit = 0;
 
-    for(const std::pair<const CWalletTx*, unsigned int> &pcoin : setStakeCoins)
+    for (const CStakeCandidate &candidate : vCandidates)
     {
-        //make sure that enough time has elapsed between
-        CBlockIndex* pindex = NULL;
-        BlockMap::iterator it = mapBlockIndex.find(pcoin.first->hashBlock);
-        if (it != mapBlockIndex.end())
-            pindex = it->second;
-        else {
-            LogPrintf("failed to find block index ");
-            continue;
-        }
-        // Read block header
-        CBlockHeader block = pindex->GetBlockHeader();
-        COutPoint prevoutStake = COutPoint(pcoin.first->GetHash(), pcoin.second);
+        boost::this_thread::interruption_point();
         nTxNewTime = GetAdjustedTime();
         //iterates each utxo inside of CheckStakeKernelHash()
-        CScript kernelScript;
-        auto stakeScript = pcoin.first->tx->vout[pcoin.second].scriptPubKey;
-        fKernelFound = CreateCoinStakeKernel(kernelScript, stakeScript, nBits,
-                                             block, sizeof(CBlock), pcoin.first->tx,
-                                             prevoutStake, nTxNewTime, false);
+        fKernelFound = CreateCoinStakeKernel(candidate, nBits, nMedianTimePast, nTxNewTime);
         if(fKernelFound)
         {
-            FillCoinStakePayments(txNew, kernelScript, prevoutStake, blockReward);
+            FillCoinStakePayments(txNew, candidate.txout.scriptPubKey, candidate.prevout, blockReward);
             break;
         }
     }
@@ -4119,16 +4333,6 @@ bool CWallet::CreateCoinStake(unsigned int nBits,
     //    if (nBytes >= DEFAULT_BLOCK_MAX_SIZE / 5){
     //        return error("CreateCoinStake() : exceeded coinstake size limit");
     //    }
-    // Update coinbase transaction with additional info about masternode and governance payments,
-    // get some info back to pass to getblocktemplate
-    CTxOut txoutMasternode;
-    std::vector<CTxOut> voutSuperblock;
-    int nHeight = chainActive.Tip()->nHeight + 1;
-    FillBlockPayments(txNew, nHeight, blockReward, txoutMasternode, voutSuperblock);
-    AdjustMasternodePayment(txNew, txoutMasternode);
-    LogPrintf("CreateCoinStake -- nBlockHeight %d blockReward %lld txoutMasternode %s txNew %s",
-              nHeight, blockReward, txoutMasternode.ToString(), txNew.ToString());
-    nLastStakeSetUpdate = 0; //this will trigger stake set to repopulate next round
     return true;
 }
 
@@ -4289,9 +4493,11 @@ bool CWallet::SetAddressBook(const CTxDestination& address, const std::string& s
                              strPurpose, (fUpdated ? CT_UPDATED : CT_NEW) );
     if (!fFileBacked)
         return false;
-    if (!strPurpose.empty() && !CWalletDB(strWalletFile).WritePurpose(CBitcoinAddress(address).ToString(), strPurpose))
+    LOCK(cs_wallet); // pwalletdbBatch
+    CWalletDBWriter walletdb(pwalletdbBatch, strWalletFile);
+    if (!strPurpose.empty() && !walletdb->WritePurpose(CBitcoinAddress(address).ToString(), strPurpose))
         return false;
-    return CWalletDB(strWalletFile).WriteName(CBitcoinAddress(address).ToString(), strName);
+    return walletdb->WriteName(CBitcoinAddress(address).ToString(), strName);
 }
 
 bool CWallet::DelAddressBook(const CTxDestination& address)
@@ -4305,7 +4511,7 @@ bool CWallet::DelAddressBook(const CTxDestination& address)
             std::string strAddress = CBitcoinAddress(address).ToString();
             BOOST_FOREACH(const PAIRTYPE(std::string, std::string) &item, mapAddressBook[address].destdata)
             {
-                CWalletDB(strWalletFile).EraseDestData(strAddress, item.first);
+                CWalletDBWriter(pwalletdbBatch, strWalletFile)->EraseDestData(strAddress, item.first);
             }
         }
         mapAddressBook.erase(address);
@@ -4315,15 +4521,18 @@ bool CWallet::DelAddressBook(const CTxDestination& address)
 
     if (!fFileBacked)
         return false;
-    CWalletDB(strWalletFile).ErasePurpose(CBitcoinAddress(address).ToString());
-    return CWalletDB(strWalletFile).EraseName(CBitcoinAddress(address).ToString());
+    LOCK(cs_wallet); // pwalletdbBatch
+    CWalletDBWriter walletdb(pwalletdbBatch, strWalletFile);
+    walletdb->ErasePurpose(CBitcoinAddress(address).ToString());
+    return walletdb->EraseName(CBitcoinAddress(address).ToString());
 }
 
 bool CWallet::SetDefaultKey(const CPubKey &vchPubKey)
 {
     if (fFileBacked)
     {
-        if (!CWalletDB(strWalletFile).WriteDefaultKey(vchPubKey))
+        LOCK(cs_wallet); // pwalletdbBatch
+        if (!CWalletDBWriter(pwalletdbBatch, strWalletFile)->WriteDefaultKey(vchPubKey))
             return false;
     }
     vchDefaultKey = vchPubKey;
@@ -4338,13 +4547,14 @@ bool CWallet::NewKeyPool()
 {
     {
         LOCK(cs_wallet);
-        CWalletDB walletdb(strWalletFile);
+        CWalletDBBatch batch(*this);
+        CWalletDBWriter walletdb(pwalletdbBatch, strWalletFile);
         BOOST_FOREACH(int64_t nIndex, setInternalKeyPool) {
-            walletdb.ErasePool(nIndex);
+            walletdb->ErasePool(nIndex);
         }
         setInternalKeyPool.clear();
         BOOST_FOREACH(int64_t nIndex, setExternalKeyPool) {
-            walletdb.ErasePool(nIndex);
+            walletdb->ErasePool(nIndex);
         }
         setExternalKeyPool.clear();
         privateSendClient.fEnablePrivateSend = false;
@@ -4400,7 +4610,8 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             nTargetSize *= 2;
         }
         bool fInternal = false;
-        CWalletDB walletdb(strWalletFile);
+        // Keys, HD chain updates and pool entries are committed together
+        CWalletDBBatch batch(*this);
         for (int64_t i = missingInternal + missingExternal; i--;)
         {
             int64_t nEnd = 1;
@@ -4414,7 +4625,8 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
                 nEnd = std::max(nEnd, *(--setExternalKeyPool.end()) + 1);
             }
             // TODO: implement keypools for all accounts?
-            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey(0, fInternal), fInternal)))
+            CPubKey pubkey = GenerateNewKey(0, fInternal);
+            if (!CWalletDBWriter(pwalletdbBatch, strWalletFile)->WritePool(nEnd, CKeyPool(pubkey, fInternal)))
                 throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
 
             if (fInternal) {
@@ -4423,6 +4635,8 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
                 setExternalKeyPool.insert(nEnd);
             }
             LogPrintf("keypool added key %d, size=%u, internal=%d\n", nEnd, setInternalKeyPool.size() + setExternalKeyPool.size(), fInternal);
+            if (nEnd % 1000 == 0)
+                CheckpointDBBatch();
 
             double dProgress = 100.f * nEnd / (nTargetSize + 1);
             std::string strMsg = strprintf(_("Loading wallet... (%3.2f %%)"), dProgress);
@@ -4449,11 +4663,11 @@ void CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool, bool fIn
         if(setKeyPool.empty())
             return;
 
-        CWalletDB walletdb(strWalletFile);
+        CWalletDBWriter walletdb(pwalletdbBatch, strWalletFile);
 
         nIndex = *setKeyPool.begin();
         setKeyPool.erase(nIndex);
-        if (!walletdb.ReadPool(nIndex, keypool)) {
+        if (!walletdb->ReadPool(nIndex, keypool)) {
             throw std::runtime_error(std::string(__func__) + ": read failed");
         }
         if (!HaveKey(keypool.vchPubKey.GetID())) {
@@ -4473,8 +4687,8 @@ void CWallet::KeepKey(int64_t nIndex)
     // Remove from key pool
     if (fFileBacked)
     {
-        CWalletDB walletdb(strWalletFile);
-        walletdb.ErasePool(nIndex);
+        LOCK(cs_wallet); // pwalletdbBatch
+        CWalletDBWriter(pwalletdbBatch, strWalletFile)->ErasePool(nIndex);
         nKeysLeftSinceAutoBackup = nWalletBackups ? nKeysLeftSinceAutoBackup - 1 : 0;
     }
     LogPrintf("keypool keep %d\n", nIndex);
@@ -4957,7 +5171,8 @@ bool CWallet::AddDestData(const CTxDestination &dest, const std::string &key, co
     mapAddressBook[dest].destdata.insert(std::make_pair(key, value));
     if (!fFileBacked)
         return true;
-    return CWalletDB(strWalletFile).WriteDestData(CBitcoinAddress(dest).ToString(), key, value);
+    LOCK(cs_wallet); // pwalletdbBatch
+    return CWalletDBWriter(pwalletdbBatch, strWalletFile)->WriteDestData(CBitcoinAddress(dest).ToString(), key, value);
 }
 
 bool CWallet::EraseDestData(const CTxDestination &dest, const std::string &key)
@@ -4966,7 +5181,8 @@ bool CWallet::EraseDestData(const CTxDestination &dest, const std::string &key)
         return false;
     if (!fFileBacked)
         return true;
-    return CWalletDB(strWalletFile).EraseDestData(CBitcoinAddress(dest).ToString(), key);
+    LOCK(cs_wallet); // pwalletdbBatch
+    return CWalletDBWriter(pwalletdbBatch, strWalletFile)->EraseDestData(CBitcoinAddress(dest).ToString(), key);
 }
 
 bool CWallet::LoadDestData(const CTxDestination &dest, const std::string &key, const std::string &value)
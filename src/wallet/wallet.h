@@ -206,6 +206,66 @@ struct COutputEntry
     int vout;
 };
 
+/** Wallet-wide balance totals, see CWallet::GetBalances() */
+struct CWalletBalances
+{
+    CAmount nBalance;
+    CAmount nUnconfirmed;
+    CAmount nImmature;
+    CAmount nWatchOnly;
+    CAmount nUnconfirmedWatchOnly;
+    CAmount nImmatureWatchOnly;
+    CAmount nAnonymized;
+    CAmount nDenominatedConfirmed;
+    CAmount nDenominatedUnconfirmed;
+
+    CWalletBalances()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        nBalance = 0;
+        nUnconfirmed = 0;
+        nImmature = 0;
+        nWatchOnly = 0;
+        nUnconfirmedWatchOnly = 0;
+        nImmatureWatchOnly = 0;
+        nAnonymized = 0;
+        nDenominatedConfirmed = 0;
+        nDenominatedUnconfirmed = 0;
+    }
+
+    CWalletBalances& operator+=(const CWalletBalances& b)
+    {
+        nBalance += b.nBalance;
+        nUnconfirmed += b.nUnconfirmed;
+        nImmature += b.nImmature;
+        nWatchOnly += b.nWatchOnly;
+        nUnconfirmedWatchOnly += b.nUnconfirmedWatchOnly;
+        nImmatureWatchOnly += b.nImmatureWatchOnly;
+        nAnonymized += b.nAnonymized;
+        nDenominatedConfirmed += b.nDenominatedConfirmed;
+        nDenominatedUnconfirmed += b.nDenominatedUnconfirmed;
+        return *this;
+    }
+
+    CWalletBalances& operator-=(const CWalletBalances& b)
+    {
+        nBalance -= b.nBalance;
+        nUnconfirmed -= b.nUnconfirmed;
+        nImmature -= b.nImmature;
+        nWatchOnly -= b.nWatchOnly;
+        nUnconfirmedWatchOnly -= b.nUnconfirmedWatchOnly;
+        nImmatureWatchOnly -= b.nImmatureWatchOnly;
+        nAnonymized -= b.nAnonymized;
+        nDenominatedConfirmed -= b.nDenominatedConfirmed;
+        nDenominatedUnconfirmed -= b.nDenominatedUnconfirmed;
+        return *this;
+    }
+};
+
 /** A transaction with a merkle branch linking it to the block chain. */
 class CMerkleTx
 {
@@ -336,6 +396,9 @@ public:
     mutable CAmount nImmatureWatchCreditCached;
     mutable CAmount nAvailableWatchCreditCached;
     mutable CAmount nChangeCached;
+    //! this tx's share of CWallet's balance totals, valid if fBalancesTallied
+    mutable bool fBalancesTallied;
+    mutable CWalletBalances balancesTallied;
 
     CWalletTx()
     {
@@ -381,6 +444,8 @@ public:
         nAvailableWatchCreditCached = 0;
         nImmatureWatchCreditCached = 0;
         nChangeCached = 0;
+        fBalancesTallied = false;
+        balancesTallied.SetNull();
         nOrderPos = -1;
     }
 
@@ -429,21 +494,7 @@ public:
     }
 
     //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        fCreditCached = false;
-        fAvailableCreditCached = false;
-        fImmatureCreditCached = false;
-        fAnonymizedCreditCached = false;
-        fDenomUnconfCreditCached = false;
-        fDenomConfCreditCached = false;
-        fWatchDebitCached = false;
-        fWatchCreditCached = false;
-        fAvailableWatchCreditCached = false;
-        fImmatureWatchCreditCached = false;
-        fDebitCached = false;
-        fChangeCached = false;
-    }
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -623,6 +674,18 @@ private:
     std::vector<char> _ssExtra;
 };
 
+/**
+ * A stake coin together with the chain data its kernel is hashed over, read
+ * under cs_main so that the kernel search itself doesn't need it.
+ */
+struct CStakeCandidate
+{
+    COutPoint prevout;
+    CTxOut txout;
+    int64_t nBlockFromTime;
+    uint64_t nStakeModifier;
+};
+
 
 /** 
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
@@ -642,6 +705,14 @@ private:
 
     CWalletDB *pwalletdbEncryption;
 
+    /**
+     * Database handle with an open transaction which all wallet writes go
+     * through while a CWalletDBBatch is alive, so that they are committed
+     * and checkpointed once. Only touched with cs_wallet held.
+     */
+    CWalletDB *pwalletdbBatch;
+    int nWalletDBBatchDepth;
+
     //! the current wallet version: clients below this version are not able to load the wallet
     int nWalletVersion;
 
@@ -654,12 +725,48 @@ private:
     // Stake Settings
     unsigned int nHashDrift;
     unsigned int nHashInterval;
-    int nStakeSetUpdateTime;
     mutable bool fAnonymizableTallyCached;
     mutable std::vector<CompactTallyItem> vecAnonymizableTallyCached;
     mutable bool fAnonymizableTallyCachedNonDenom;
     mutable std::vector<CompactTallyItem> vecAnonymizableTallyCachedNonDenom;
 
+    /**
+     * Balance totals are the sum of every CWalletTx::balancesTallied and are
+     * only updated for transactions which changed since the last read.
+     * Unconfirmed and immature transactions also depend on the mempool and
+     * the chain tip, so they are re-tallied on every read and on every
+     * new tip respectively.
+     */
+    mutable CWalletBalances balancesTotal;
+    mutable bool fBalancesFullRecalc;
+    mutable uint256 hashBalancesTip;
+    mutable std::set<uint256> setBalancesDirty;
+    mutable std::set<uint256> setBalancesUnconfirmed;
+    mutable std::set<uint256> setBalancesImmature;
+
+    void TallyBalances(const CWalletTx& wtx) const;
+    void UpdateBalances() const;
+
+    /**
+     * Coins which can stake right now, and coins which only lack stake age
+     * or confirmations. Kept up to date from transactions marked dirty
+     * instead of being rebuilt from AvailableCoins() on every stake attempt.
+     * Immature coinbase transactions provide no coins at all, so they are
+     * looked at again on every new tip until they mature.
+     */
+    mutable std::set<std::pair<const CWalletTx*, unsigned int> > setStakeCoins;
+    mutable std::set<std::pair<const CWalletTx*, unsigned int> > setStakeCoinsPending;
+    mutable bool fStakeCoinsFullRebuild;
+    mutable uint256 hashStakeCoinsTip;
+    mutable std::set<uint256> setStakeCoinsDirty;
+    mutable std::set<uint256> setStakeCoinsImmature;
+
+    void AddStakeCandidate(const COutput& out) const;
+    void AddStakeCandidatesFromTx(const CWalletTx* pcoin) const;
+    void UpdateStakeCoins() const;
+
+    void AvailableCoinsFromTx(std::vector<COutput>& vCoins, const CWalletTx* pcoin, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue, AvailableCoinsType nCoinType, bool fUseInstantSend) const;
+
     /**
      * Used to keep track of spent outpoints, and
      * detect and report conflicts (double-spends or
@@ -670,7 +777,10 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    //! Outputs of ours which are (or were recently) unspent, candidates for AvailableCoins()
     std::set<COutPoint> setWalletUTXO;
+    //! Add the unspent outputs of ours of a wallet tx to setWalletUTXO
+    void SyncWalletUTXO(const uint256& hashTx);
 
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
@@ -680,10 +790,8 @@ private:
     /* HD derive new child key (on internal or external chain) */
     void DeriveNewChildKey(const CKeyMetadata& metadata, CKey& secretRet, uint32_t nAccountIndex, bool fInternal /*= false*/);
 
-    bool CreateCoinStakeKernel(CScript &kernelScript, const CScript &stakeScript,
-                               unsigned int nBits, const CBlock& blockFrom,
-                               unsigned int nTxPrevOffset, const CTransactionRef &txPrev,
-                               const COutPoint& prevout, unsigned int &nTimeTx, bool fPrintProofOfStake) const;
+    bool CreateCoinStakeKernel(const CStakeCandidate& candidate, unsigned int nBits,
+                               int64_t nMedianTimePast, unsigned int &nTimeTx) const;
     void FillCoinStakePayments(CMutableTransaction &transaction,
                                const CScript &kernelScript,
                                const COutPoint &stakePrevout, CAmount blockReward) const;
@@ -758,6 +866,8 @@ public:
     {
         delete pwalletdbEncryption;
         pwalletdbEncryption = NULL;
+        delete pwalletdbBatch;
+        pwalletdbBatch = NULL;
     }
 
     void SetNull()
@@ -767,6 +877,8 @@ public:
         fFileBacked = false;
         nMasterKeyMaxID = 0;
         pwalletdbEncryption = NULL;
+        pwalletdbBatch = NULL;
+        nWalletDBBatchDepth = 0;
         nOrderPosNext = 0;
         nNextResend = 0;
         nLastResend = 0;
@@ -776,12 +888,13 @@ public:
         fAnonymizableTallyCachedNonDenom = false;
         vecAnonymizableTallyCached.clear();
         vecAnonymizableTallyCachedNonDenom.clear();
+        fBalancesFullRecalc = true;
+        fStakeCoinsFullRebuild = true;
 
         // Stake Settings
         nHashDrift = 45;
         nStakeSplitThreshold = 2000;
         nHashInterval = 22;
-        nStakeSetUpdateTime = 300; // 5 minutes
     }
 
     std::map<uint256, CWalletTx> mapWallet;
@@ -822,9 +935,7 @@ public:
      * assembled
      */
     bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, bool fUseInstantSend = false) const;
-    using StakeCoinsSet = std::set<std::pair<const CWalletTx*, unsigned int> >;
     bool MintableCoins();
-    bool SelectStakeCoins(StakeCoinsSet& setCoins, CAmount nTargetAmount, const CScript &scriptFilterPubKey = CScript()) const;
     // Coin selection
     bool SelectCoinsByDenominations(int nDenom, CAmount nValueMin, CAmount nValueMax, std::vector<CTxDSIn>& vecTxDSInRet, std::vector<COutput>& vCoinsRet, CAmount& nValueRet, int nPrivateSendRoundsMin, int nPrivateSendRoundsMax);
     bool GetCollateralTxDSIn(CTxDSIn& txdsinRet, CAmount& nValueRet) const;
@@ -909,6 +1020,17 @@ public:
 
     void GetKeyBirthTimes(std::map<CTxDestination, int64_t> &mapKeyBirth) const;
 
+    /**
+     * Group the database writes which follow into a single transaction,
+     * use CWalletDBBatch rather than calling these directly. Batches nest,
+     * only the outermost CommitDBBatch() commits. CheckpointDBBatch()
+     * commits what has been written so far and carries on in a new
+     * transaction, to keep long batches bounded.
+     */
+    void BeginDBBatch(bool fFlushOnClose = true);
+    bool CommitDBBatch();
+    bool CheckpointDBBatch();
+
     /** 
      * Increment the next transaction order id
      * @return next transaction order id
@@ -919,6 +1041,8 @@ public:
     bool GetAccountPubkey(CPubKey &pubKey, std::string strAccount, bool bForceNew = false);
 
     void MarkDirty();
+    //! Called by CWalletTx::MarkDirty() to re-tally balances and stake coins of the tx when next needed
+    void MarkTxDirty(const uint256& hashTx) const;
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose=true);
     bool LoadToWallet(const CWalletTx& wtxIn);
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock) override;
@@ -927,6 +1051,7 @@ public:
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman) override;
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime, CConnman* connman);
+    CWalletBalances GetBalances() const;
     CAmount GetBalance() const;
     CAmount GetUnconfirmedBalance() const;
     CAmount GetImmatureBalance() const;
@@ -935,6 +1060,8 @@ public:
     CAmount GetImmatureWatchOnlyBalance() const;
     CAmount GetStake() const;
     int GetStakeInputs() const;
+    int GetPendingStakeInputs() const;
+    CAmount GetStakeWeight() const;
 
     CAmount GetAnonymizableBalance(bool fSkipDenominated = false, bool fSkipUnconfirmed = true) const;
     CAmount GetAnonymizedBalance() const;
@@ -960,9 +1087,14 @@ public:
     bool CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletTx& wtxNew, CReserveKey& reservekey, CAmount& nFeeRet, int& nChangePosInOut,
                            std::string& strFailReason, const CCoinControl *coinControl = NULL, bool sign = true, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend=false);
     bool CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, CConnman* connman, CValidationState& state, const std::string& strCommand="tx");
-    bool CreateCoinStake(unsigned int nBits, CAmount blockReward,
-                         CMutableTransaction& txNew, unsigned int& nTxNewTime,
-                         std::vector<CWalletTx *> &vwtxPrev);
+    /**
+     * Search our stake coins for a kernel on top of pindexPrev and fill in the
+     * stake inputs and outputs of txNew. Chain data is only read up front, the
+     * search runs without cs_main, which the caller must not hold either.
+     * Block payments are left to the caller.
+     */
+    bool CreateCoinStake(const CBlockIndex* pindexPrev, unsigned int nBits, CAmount blockReward,
+                         CMutableTransaction& txNew, unsigned int& nTxNewTime);
     bool CreateCollateralTransaction(CMutableTransaction& txCollateral, std::string& strReason);
     bool ConvertList(std::vector<CTxIn> vecTxIn, std::vector<CAmount>& vecAmounts);
 
@@ -1144,6 +1276,33 @@ public:
     bool GetDecryptedHDChain(CHDChain& hdChainRet);
 };
 
+/**
+ * RAII helper batching all writes to the wallet database made while it is
+ * alive. cs_wallet must be held for its whole lifetime: other handles on the
+ * wallet file would block on the pages locked by the open transaction, so
+ * writers outside of the batch go through pwalletdbBatch when it is open.
+ * Unless fFlushOnClose is false, the wallet is flushed once it is committed.
+ */
+class CWalletDBBatch
+{
+private:
+    CWallet& wallet;
+
+    CWalletDBBatch(const CWalletDBBatch&);
+    void operator=(const CWalletDBBatch&);
+
+public:
+    explicit CWalletDBBatch(CWallet& walletIn, bool fFlushOnClose = true) : wallet(walletIn)
+    {
+        wallet.BeginDBBatch(fFlushOnClose);
+    }
+
+    ~CWalletDBBatch()
+    {
+        wallet.CommitDBBatch();
+    }
+};
+
 /** A key allocated from the key pool. */
 class CReserveKey : public CReserveScript
 {
@@ -839,6 +839,11 @@ void ThreadFlushWalletDB()
 
         if (nLastFlushed != CWalletDB::GetUpdateCounter() && GetTime() - nLastWalletUpdate >= 2)
         {
+            // Write the logged changes to the data file before taking cs_db,
+            // so that only closing and detaching the file is left to do under
+            // the lock and wallet writers don't stall behind the flush.
+            bitdb.dbenv->txn_checkpoint(0, 0, 0);
+
             TRY_LOCK(bitdb.cs_db,lockDb);
             if (lockDb)
             {